@@ -1,6 +1,7 @@
 // 
 
 import Foundation
+import WireTransport
 
 public final class AssetRequestFactory : NSObject {
     
@@ -37,11 +38,29 @@ public final class AssetRequestFactory : NSObject {
             static let multipart = "multipart/mixed; boundary=frontier"
         }
     }
-
-    public func backgroundUpstreamRequestForAsset(message: ZMAssetClientMessage, withData data: Data, shareable: Bool = true, retention: Retention) -> ZMTransportRequest? {
-        guard let uploadURL = uploadURL(for: message, in: message.managedObjectContext!, shareable: shareable, retention: retention, data: data) else { return nil }
+    
+    /// Directory the multipart bodies of background uploads are written to
+    let uploadsDirectory: URL?
+    
+    public override convenience init() {
+        self.init(uploadsDirectory: AssetRequestFactory.defaultUploadsDirectory)
+    }
+    
+    init(uploadsDirectory: URL?) {
+        self.uploadsDirectory = uploadsDirectory
+        super.init()
+    }
+    
+    public func backgroundUpstreamRequestForAsset(message: ZMAssetClientMessage, withData data: Data, assetIndex: Int = 0, shareable: Bool = true, retention: Retention) -> ZMTransportRequest? {
+        let fileName = message.nonce.map { "\($0.transportString())-\(assetIndex)" } ?? UUID().transportString()
+        guard
+            let moc = message.managedObjectContext,
+            let uploadURL = uploadURL(named: fileName, shareable: shareable, retention: retention, data: data) else { return nil }
         let request = ZMTransportRequest.uploadRequest(withFileURL: uploadURL, path: Constant.path, contentType: Constant.ContentType.multipart)
         request.addContentDebugInformation("Uploading full asset to /assets/v3")
+        request.add(ZMCompletionHandler(on: moc) { _ in
+            try? FileManager.default.removeItem(at: uploadURL)
+        })
         return request
     }
 
@@ -60,9 +79,53 @@ public final class AssetRequestFactory : NSObject {
             ], boundary: Constant.boundary)
     }
 
-    private func uploadURL(for message: ZMAssetClientMessage, in moc: NSManagedObjectContext, shareable: Bool, retention: Retention, data: Data) -> URL? {
-        guard let multipartData = try? dataForMultipartAssetUploadRequest(data, shareable: shareable, retention: retention) else { return nil }
-        return moc.zm_fileAssetCache.storeRequestData(message, data: multipartData)
+    /// Writes the multipart body for the upload into its own file, without building it in memory.
+    /// The file is named after the asset, so uploading it again replaces the file of the previous attempt.
+    private func uploadURL(named fileName: String, shareable: Bool, retention: Retention, data: Data) -> URL? {
+        guard
+            let directory = uploadsDirectory,
+            let metaData = try? JSONSerialization.data(withJSONObject: [Constant.accessLevel: shareable, Constant.retention: retention.rawValue], options: []) else { return nil }
+        
+        let url = directory.appendingPathComponent(fileName)
+        do {
+            try MultipartUploadFileWriter(boundary: Constant.boundary).write(metadata: metaData,
+                                                                             metadataContentType: Constant.ContentType.json,
+                                                                             content: data,
+                                                                             contentType: Constant.ContentType.octetStream,
+                                                                             to: url)
+        } catch {
+            return nil
+        }
+        return url
+    }
+    
+    /// Directory of the multipart bodies of the uploads in progress. It is in the caches of the shared
+    /// container of the app group, next to the file asset cache, so that the extensions can upload too.
+    static let defaultUploadsDirectory: URL? = {
+        let groupIdentifier = UserDefaults.standard.string(forKey: EnvironmentType.groupIdentifier)
+        let sharedContainer = groupIdentifier.flatMap { FileManager.default.containerURL(forSecurityApplicationGroupIdentifier: $0) }
+        guard let caches = sharedContainer?.appendingPathComponent("Library/Caches", isDirectory: true)
+            ?? FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first else { return nil }
+        let directory = caches.appendingPathComponent("AssetUploads", isDirectory: true)
+        FileManager.default.createAndProtectDirectory(at: directory)
+        return directory
+    }()
+    
+    /// Upload files are kept this long before they are considered orphaned. A background session
+    /// may still be sending a file after a relaunch, so recent files are left alone.
+    static let orphanedUploadFileAge: TimeInterval = 24 * 60 * 60
+    
+    /// Removes the upload files of requests which never completed, e.g. because the app was terminated
+    static func removeOrphanedUploadFiles(in directory: URL? = defaultUploadsDirectory, olderThan age: TimeInterval = orphanedUploadFileAge, now: Date = Date()) {
+        guard
+            let directory = directory,
+            let files = try? FileManager.default.contentsOfDirectory(at: directory, includingPropertiesForKeys: [.contentModificationDateKey], options: .skipsHiddenFiles) else { return }
+        
+        for file in files {
+            guard let modificationDate = (try? file.resourceValues(forKeys: [.contentModificationDateKey]))?.contentModificationDate,
+                  now.timeIntervalSince(modificationDate) > age else { continue }
+            try? FileManager.default.removeItem(at: file)
+        }
     }
     
 }
@@ -87,3 +87,92 @@ class AssetRequestFactoryTests: ZMTBaseTest {
         XCTAssert(waitForAllGroupsToBeEmpty(withTimeout: 0.2))
     }
 }
+
+// MARK: - Multipart upload file
+extension AssetRequestFactoryTests {
+    
+    func uploadFileURL() -> URL {
+        return FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    }
+    
+    func testThatItWritesTheSameMultipartBodyAsTheInMemoryBuilder() throws {
+        // given
+        let metadata = "{\"public\":false}".data(using: .utf8)!
+        let content = Data((0..<(MultipartUploadFileWriter.chunkSize * 2 + 17)).map { UInt8($0 % 251) })
+        let url = uploadFileURL()
+        defer { try? FileManager.default.removeItem(at: url) }
+        
+        let expected = NSData.multipartData(withItems: [
+            ZMMultipartBodyItem(data: metadata, contentType: "application/json", headers: nil),
+            ZMMultipartBodyItem(data: content, contentType: "application/octet-stream", headers: ["Content-MD5": (content as NSData).zmMD5Digest().base64String()]),
+            ], boundary: "frontier")
+        
+        // when
+        try MultipartUploadFileWriter(boundary: "frontier").write(metadata: metadata,
+                                                                  metadataContentType: "application/json",
+                                                                  content: content,
+                                                                  contentType: "application/octet-stream",
+                                                                  to: url)
+        
+        // then
+        XCTAssertEqual(try Data(contentsOf: url), expected)
+    }
+    
+    func testThatItFailsAndRemovesTheFileWhenTheContentIsShorterThanAnnounced() {
+        // given
+        let content = Data(count: 10)
+        let url = uploadFileURL()
+        
+        // when
+        XCTAssertThrowsError(try MultipartUploadFileWriter(boundary: "frontier").write(metadata: Data(),
+                                                                                       metadataContentType: "application/json",
+                                                                                       content: InputStream(data: content),
+                                                                                       contentLength: 20,
+                                                                                       contentType: "application/octet-stream",
+                                                                                       to: url))
+        
+        // then
+        XCTAssertFalse(FileManager.default.fileExists(atPath: url.path))
+    }
+    
+    func testThatItWritesTheUploadFileIntoTheDirectoryItIsGiven() throws {
+        // given
+        let directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        defer { try? FileManager.default.removeItem(at: directory) }
+        let sut = AssetRequestFactory(uploadsDirectory: directory)
+        
+        testSession.syncMOC.performGroupedBlockAndWait {
+            let message = ZMAssetClientMessage(nonce: UUID(), managedObjectContext: self.testSession.syncMOC)
+            
+            // when
+            let request = sut.backgroundUpstreamRequestForAsset(message: message, withData: Data(count: 100), assetIndex: 1, retention: .expiring)
+            
+            // then
+            XCTAssertNotNil(request)
+            let fileName = "\(message.nonce!.transportString())-1"
+            XCTAssertTrue(FileManager.default.fileExists(atPath: directory.appendingPathComponent(fileName).path))
+        }
+    }
+    
+    func testThatItRemovesOnlyTheUploadFilesOlderThanTheOrphanAge() throws {
+        // given
+        let directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        defer { try? FileManager.default.removeItem(at: directory) }
+        
+        let now = Date()
+        let orphaned = directory.appendingPathComponent("orphaned")
+        let recent = directory.appendingPathComponent("recent")
+        try Data(count: 10).write(to: orphaned)
+        try Data(count: 10).write(to: recent)
+        try FileManager.default.setAttributes([.modificationDate: now.addingTimeInterval(-AssetRequestFactory.orphanedUploadFileAge - 60)], ofItemAtPath: orphaned.path)
+        
+        // when
+        AssetRequestFactory.removeOrphanedUploadFiles(in: directory, now: now)
+        
+        // then
+        XCTAssertFalse(FileManager.default.fileExists(atPath: orphaned.path))
+        XCTAssertTrue(FileManager.default.fileExists(atPath: recent.path))
+    }
+}
@@ -0,0 +1,342 @@
+//
+
+import Foundation
+import UIKit
+import WireDataModel
+
+/// A count of occurrences, e.g. of decrypted events
+@objc(ZMMetricsCounter)
+public final class MetricsCounter: NSObject {
+
+    public let name: String
+    private let storage = ZMAtomicCounter()
+
+    init(name: String) {
+        self.name = name
+        super.init()
+    }
+
+    @objc(incrementBy:)
+    public func increment(by amount: Int64) {
+        storage.add(amount)
+    }
+
+    @objc public func increment() {
+        storage.add(1)
+    }
+
+    /// Count since the last flush
+    public var value: Int64 {
+        return storage.value
+    }
+
+    fileprivate func drain() -> Int64 {
+        return storage.drain()
+    }
+}
+
+/// A level which is sampled, e.g. the number of objects waiting to be synced
+@objc(ZMMetricsGauge)
+public final class MetricsGauge: NSObject {
+
+    public let name: String
+    private let storage = ZMAtomicGauge()
+
+    init(name: String) {
+        self.name = name
+        super.init()
+    }
+
+    @objc public var value: Int64 {
+        get { return storage.value }
+        set { storage.value = newValue }
+    }
+
+    /// Adds to the level, e.g. when an item is queued, and subtracts a negative amount when it leaves
+    @objc(incrementBy:)
+    public func increment(by amount: Int64) {
+        storage.add(amount)
+    }
+}
+
+/// A distribution of durations, counted in fixed buckets
+@objc(ZMMetricsHistogram)
+public final class MetricsHistogram: NSObject {
+
+    /// Upper bounds of the buckets in seconds, from 1ms to 10s
+    public static let defaultLatencyBuckets: [TimeInterval] = [0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10]
+
+    public let name: String
+    public let bucketBounds: [TimeInterval]
+    /// One more bucket than bounds, for the durations above the last bound
+    private let buckets: [ZMAtomicCounter]
+
+    init(name: String, bucketBounds: [TimeInterval]) {
+        self.name = name
+        self.bucketBounds = bucketBounds.sorted()
+        self.buckets = (0...bucketBounds.count).map { _ in ZMAtomicCounter(stripeCount: 1) }
+        super.init()
+    }
+
+    @objc(recordDuration:)
+    public func record(_ duration: TimeInterval) {
+        buckets[bucketIndex(for: duration)].add(1)
+    }
+
+    /// Records the time elapsed since the start time, taken with `CFAbsoluteTimeGetCurrent()`
+    @objc(recordDurationSinceTime:)
+    public func record(since startTime: CFAbsoluteTime) {
+        record(CFAbsoluteTimeGetCurrent() - startTime)
+    }
+
+    public func measure<T>(_ block: () throws -> T) rethrows -> T {
+        let startTime = CFAbsoluteTimeGetCurrent()
+        defer { record(since: startTime) }
+        return try block()
+    }
+
+    /// Counts of each bucket since the last flush
+    public var counts: [Int64] {
+        return buckets.map { $0.value }
+    }
+
+    /// Names of the attributes under which the buckets are reported, e.g. `decrypt_lt_5ms`
+    public var bucketNames: [String] {
+        let milliseconds = bucketBounds.map { String(format: "%gms", $0 * 1000) }
+        return milliseconds.map { "\(name)_lt_\($0)" } + ["\(name)_gte_\(milliseconds.last ?? "0ms")"]
+    }
+
+    fileprivate func drain() -> [Int64] {
+        return buckets.map { $0.drain() }
+    }
+
+    private func bucketIndex(for duration: TimeInterval) -> Int {
+        var (low, high) = (0, bucketBounds.count)
+        while low < high {
+            let middle = (low + high) / 2
+            if duration < bucketBounds[middle] {
+                high = middle
+            } else {
+                low = middle + 1
+            }
+        }
+        return low
+    }
+}
+
+/// Collects counters, gauges and histograms in memory and periodically adds them
+/// to the persisted attributes of their event in `AnalyticsType`.
+///
+/// Reporting a value doesn't take a lock nor touch the storage, only the flush does. Metrics should be
+/// looked up once and kept, since looking them up by name takes a lock.
+@objc(ZMMetrics)
+public final class Metrics: NSObject {
+
+    /// Event under which metrics are reported when not specified otherwise
+    public static let defaultEvent = "metrics"
+
+    /// Event under which the object syncs report the objects waiting to be synced and the duration of their requests
+    @objc public static let objectSyncEvent = "object_sync"
+
+    /// Event under which the request strategies report the requests in flight and their latency
+    @objc public static let requestStrategyEvent = "request_strategy"
+
+    /// Attribute of a periodically dispatched event with the time since 1970 at which its values started being collected
+    public static let periodStartAttribute = "period_start"
+
+    /// Registry of the metrics reported by the framework. Nothing is flushed until `analytics` is set,
+    /// which the `NotificationsTracker` does. Values are only persisted; no event is tagged unless the app
+    /// dispatches it, since attribute names such as those of `objectSyncEvent` contain class names.
+    @objc(sharedMetrics)
+    public static let shared = Metrics()
+
+    @objc public weak var analytics: AnalyticsType? {
+        didSet {
+            scheduleFlush()
+        }
+    }
+
+    /// Interval after which the metrics are flushed
+    public let flushInterval: TimeInterval
+
+    /// Interval covered by a periodically dispatched event
+    public let dispatchInterval: TimeInterval
+
+    /// Guards the metrics, taken briefly when looking them up and when taking a snapshot to flush
+    private let lock = NSLock()
+    /// Serializes the reads and writes of the persisted attributes, which happen outside of `lock`
+    private let storageLock = NSLock()
+    /// Metrics by event and name
+    private var counters: [String: [String: MetricsCounter]] = [:]
+    private var gauges: [String: [String: MetricsGauge]] = [:]
+    private var histograms: [String: [String: MetricsHistogram]] = [:]
+    /// Gauge values written by the last flush, so that unchanged values are not written again
+    private var flushedGaugeValues: [ObjectIdentifier: Int64] = [:]
+    /// Events dispatched when their persisted attributes cover `dispatchInterval`
+    private var periodicEvents: Set<String> = []
+    private let scheduler: TimedRequestScheduler
+    private var backgroundObserver: NSObjectProtocol?
+
+    public init(analytics: AnalyticsType? = nil,
+                flushInterval: TimeInterval = 60,
+                dispatchInterval: TimeInterval = 24 * 60 * 60,
+                scheduler: TimedRequestScheduler = .shared) {
+        self.analytics = analytics
+        self.flushInterval = flushInterval
+        self.dispatchInterval = dispatchInterval
+        self.scheduler = scheduler
+        super.init()
+
+        // The flush timer doesn't fire once the process is suspended in the background, so this is the
+        // only flush covering the values reported before that
+        backgroundObserver = NotificationCenter.default.addObserver(forName: UIApplication.didEnterBackgroundNotification, object: nil, queue: nil) { [weak self] _ in
+            self?.flush()
+        }
+        scheduleFlush()
+    }
+
+    deinit {
+        backgroundObserver.map(NotificationCenter.default.removeObserver)
+    }
+
+    // MARK: - Metrics
+
+    @objc(counterNamed:event:)
+    public func counter(_ name: String, event: String = Metrics.defaultEvent) -> MetricsCounter {
+        return metric(name, event: event, in: &counters) { MetricsCounter(name: name) }
+    }
+
+    @objc(gaugeNamed:event:)
+    public func gauge(_ name: String, event: String = Metrics.defaultEvent) -> MetricsGauge {
+        return metric(name, event: event, in: &gauges) { MetricsGauge(name: name) }
+    }
+
+    @objc(histogramNamed:event:)
+    public func histogram(_ name: String, event: String = Metrics.defaultEvent) -> MetricsHistogram {
+        return histogram(name, event: event, bucketBounds: MetricsHistogram.defaultLatencyBuckets)
+    }
+
+    /// Returns the histogram registered with this name if there is one, ignoring the bucket bounds
+    public func histogram(_ name: String, event: String = Metrics.defaultEvent, bucketBounds: [TimeInterval]) -> MetricsHistogram {
+        return metric(name, event: event, in: &histograms) { MetricsHistogram(name: name, bucketBounds: bucketBounds) }
+    }
+
+    // MARK: - Flushing
+
+    /// Dispatches the event once the values flushed into it cover `dispatchInterval`.
+    /// Opt-in, the attributes of the event are sent to the analytics backend as they are named.
+    @objc(dispatchEventPeriodically:)
+    public func dispatchPeriodically(_ event: String) {
+        lock.lock()
+        defer { lock.unlock() }
+        periodicEvents.insert(event)
+    }
+
+    /// Adds the values reported since the last flush to the persisted attributes of their events
+    @objc public func flush() {
+        guard let analytics = analytics else { return }
+        let (changesByEvent, periodicEvents) = takeSnapshot()
+        guard !changesByEvent.isEmpty else { return }
+
+        storageLock.lock()
+        defer { storageLock.unlock() }
+
+        let now = Date().timeIntervalSince1970
+        for (event, changes) in changesByEvent {
+            var attributes = analytics.persistedAttributes(for: event) ?? [:]
+            for (name, delta) in changes.deltas {
+                attributes[name] = (((attributes[name] as? Double) ?? 0) + Double(delta)) as NSObject
+            }
+            changes.gauges.forEach { attributes[$0] = $1 }
+
+            guard periodicEvents.contains(event) else {
+                analytics.setPersistedAttributes(attributes, for: event)
+                continue
+            }
+            let periodStart = (attributes[Metrics.periodStartAttribute] as? Double) ?? now
+            attributes[Metrics.periodStartAttribute] = periodStart as NSObject
+            analytics.setPersistedAttributes(attributes, for: event)
+            if now - periodStart >= dispatchInterval {
+                tagEvent(event, with: attributes, in: analytics)
+            }
+        }
+    }
+
+    /// Flushes the metrics and tags the event with its persisted attributes, which are then reset
+    @objc(dispatchEvent:)
+    public func dispatchEvent(_ event: String) {
+        flush()
+
+        guard let analytics = analytics else { return }
+
+        storageLock.lock()
+        defer { storageLock.unlock() }
+
+        guard let attributes = analytics.persistedAttributes(for: event), !attributes.isEmpty else { return }
+        tagEvent(event, with: attributes, in: analytics)
+    }
+
+    /// Drains the counters and histograms and reads the gauges which changed since the last flush
+    private func takeSnapshot() -> (changesByEvent: [String: (deltas: [String: Int64], gauges: [String: NSObject])], periodicEvents: Set<String>) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        var changesByEvent: [String: (deltas: [String: Int64], gauges: [String: NSObject])] = [:]
+        let events = Set(counters.keys).union(gauges.keys).union(histograms.keys)
+        for event in events {
+            var deltas: [String: Int64] = [:]
+            var gaugeValues: [String: NSObject] = [:]
+
+            counters[event]?.values.forEach { deltas[$0.name] = $0.drain() }
+            histograms[event]?.values.forEach { histogram in
+                zip(histogram.bucketNames, histogram.drain()).forEach { deltas[$0] = $1 }
+            }
+            gauges[event]?.values.forEach { gauge in
+                let value = gauge.value
+                guard flushedGaugeValues[ObjectIdentifier(gauge)] != value else { return }
+                flushedGaugeValues[ObjectIdentifier(gauge)] = value
+                gaugeValues[gauge.name] = Double(value) as NSObject
+            }
+
+            let nonZeroDeltas = deltas.filter { $0.value != 0 }
+            guard !nonZeroDeltas.isEmpty || !gaugeValues.isEmpty else { continue }
+            changesByEvent[event] = (nonZeroDeltas, gaugeValues)
+        }
+        return (changesByEvent, periodicEvents)
+    }
+
+    /// Must be called with `storageLock` held
+    private func tagEvent(_ event: String, with attributes: [String: NSObject], in analytics: AnalyticsType) {
+        analytics.tagEvent(event, attributes: attributes)
+        analytics.setPersistedAttributes(nil, for: event)
+
+        lock.lock()
+        gauges[event]?.values.forEach { flushedGaugeValues[ObjectIdentifier($0)] = nil }
+        lock.unlock()
+    }
+
+    // MARK: - Helpers
+
+    private func metric<T>(_ name: String, event: String, in metrics: inout [String: [String: T]], create: () -> T) -> T {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let existing = metrics[event]?[name] {
+            return existing
+        }
+        let metric = create()
+        metrics[event, default: [:]][name] = metric
+        return metric
+    }
+
+    private func scheduleFlush() {
+        guard analytics != nil else {
+            scheduler.cancel(for: self)
+            return
+        }
+        scheduler.schedule(for: self, after: flushInterval) { [weak self] in
+            self?.flush()
+            self?.scheduleFlush()
+        }
+    }
+}
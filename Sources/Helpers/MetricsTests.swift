@@ -0,0 +1,173 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class MetricsTests: XCTestCase {
+
+    var analytics: MockAnalytics!
+    var sut: Metrics!
+
+    override func setUp() {
+        super.setUp()
+        analytics = MockAnalytics()
+        sut = Metrics(analytics: analytics, flushInterval: 1000, scheduler: TimedRequestScheduler(notificationCenter: NotificationCenter()))
+    }
+
+    override func tearDown() {
+        sut = nil
+        analytics = nil
+        super.tearDown()
+    }
+
+    func testThatItReturnsTheSameMetricForTheSameName() {
+        XCTAssertTrue(sut.counter("a") === sut.counter("a"))
+        XCTAssertFalse(sut.counter("a") === sut.counter("a", event: "other"))
+    }
+
+    func testThatItCountsIncrementsFromManyThreads() {
+        // given
+        let counter = sut.counter("count")
+
+        // when
+        DispatchQueue.concurrentPerform(iterations: 1000) { _ in
+            counter.increment()
+        }
+
+        // then
+        XCTAssertEqual(counter.value, 1000)
+    }
+
+    func testThatItDoesNotWriteToTheStorageWhenIncrementing() {
+        // when
+        sut.counter("count").increment(by: 3)
+
+        // then
+        XCTAssertEqual(analytics.persistedAttributesWriteCount, 0)
+    }
+
+    func testThatItAddsTheCountsToThePersistedAttributesWhenFlushing() {
+        // given
+        analytics.setPersistedAttributes(["count": 2.0 as NSObject], for: "event")
+        let counter = sut.counter("count", event: "event")
+        counter.increment(by: 3)
+
+        // when
+        sut.flush()
+
+        // then
+        XCTAssertEqual(analytics.persistedAttributes(for: "event")?["count"] as? Double, 5)
+        XCTAssertEqual(counter.value, 0)
+    }
+
+    func testThatItDoesNotWriteToTheStorageWhenNothingChanged() {
+        // given
+        sut.counter("count").increment()
+        sut.gauge("gauge").value = 4
+        sut.flush()
+        let writeCount = analytics.persistedAttributesWriteCount
+
+        // when
+        sut.flush()
+
+        // then
+        XCTAssertEqual(analytics.persistedAttributesWriteCount, writeCount)
+    }
+
+    func testThatItWritesTheCurrentValueOfGauges() {
+        // given
+        let gauge = sut.gauge("pending")
+        gauge.value = 4
+        sut.flush()
+
+        // when
+        gauge.value = 2
+        sut.flush()
+
+        // then
+        XCTAssertEqual(analytics.persistedAttributes(for: Metrics.defaultEvent)?["pending"] as? Double, 2)
+    }
+
+    func testThatItCountsDurationsInTheirBucket() {
+        // given
+        let histogram = sut.histogram("decryption", bucketBounds: [0.01, 0.1])
+
+        // when
+        histogram.record(0.005)
+        histogram.record(0.01)
+        histogram.record(0.05)
+        histogram.record(2)
+
+        // then
+        XCTAssertEqual(histogram.counts, [1, 2, 1])
+        XCTAssertEqual(histogram.bucketNames, ["decryption_lt_10ms", "decryption_lt_100ms", "decryption_gte_100ms"])
+    }
+
+    func testThatItTagsTheEventWithThePersistedAttributesAndResetsThem() {
+        // given
+        sut.counter("count", event: "event").increment(by: 2)
+
+        // when
+        sut.dispatchEvent("event")
+
+        // then
+        XCTAssertEqual(analytics.taggedEvents.count, 1)
+        XCTAssertEqual(analytics.taggedEvents.first?.event, "event")
+        XCTAssertEqual(analytics.taggedEvents.first?.attributes["count"] as? Double, 2)
+        XCTAssertNil(analytics.persistedAttributes(for: "event"))
+    }
+
+    func testThatItDoesNotTagTheEventWhenThereIsNothingToReport() {
+        // when
+        sut.dispatchEvent("event")
+
+        // then
+        XCTAssertTrue(analytics.taggedEvents.isEmpty)
+    }
+
+    func testThatItDispatchesAPeriodicEventOnceItCoversTheDispatchInterval() {
+        // given
+        sut = Metrics(analytics: analytics, flushInterval: 1000, dispatchInterval: 0, scheduler: TimedRequestScheduler(notificationCenter: NotificationCenter()))
+        sut.dispatchPeriodically("event")
+        sut.counter("count", event: "event").increment(by: 2)
+
+        // when
+        sut.flush()
+
+        // then
+        XCTAssertEqual(analytics.taggedEvents.count, 1)
+        XCTAssertEqual(analytics.taggedEvents.first?.attributes["count"] as? Double, 2)
+        XCTAssertNotNil(analytics.taggedEvents.first?.attributes[Metrics.periodStartAttribute])
+        XCTAssertNil(analytics.persistedAttributes(for: "event"))
+    }
+
+    func testThatItKeepsCollectingAPeriodicEventWithinTheDispatchInterval() {
+        // given
+        sut.dispatchPeriodically("event")
+        sut.counter("count", event: "event").increment(by: 2)
+
+        // when
+        sut.flush()
+
+        // then
+        XCTAssertTrue(analytics.taggedEvents.isEmpty)
+        XCTAssertNotNil(analytics.persistedAttributes(for: "event")?[Metrics.periodStartAttribute])
+    }
+
+    func testThatTheSharedMetricsDoNotDispatchTheObjectSyncEventByThemselves() {
+        // given
+        let analytics = MockAnalytics()
+        let previousAnalytics = Metrics.shared.analytics
+        Metrics.shared.analytics = analytics
+        defer { Metrics.shared.analytics = previousAnalytics }
+        Metrics.shared.gauge("test_pending", event: Metrics.objectSyncEvent).value = 3
+
+        // when
+        Metrics.shared.flush()
+
+        // then
+        XCTAssertEqual(analytics.persistedAttributes(for: Metrics.objectSyncEvent)?["test_pending"] as? Double, 3)
+        XCTAssertNil(analytics.persistedAttributes(for: Metrics.objectSyncEvent)?[Metrics.periodStartAttribute])
+        XCTAssertTrue(analytics.taggedEvents.isEmpty)
+    }
+}
@@ -0,0 +1,141 @@
+//
+
+import Foundation
+import CommonCrypto
+
+/// Writes the multipart body of an asset upload straight into a file.
+///
+/// The body has the same layout as `NSData.multipartData(withItems:boundary:)`, a JSON metadata part
+/// followed by the asset part with its `Content-MD5` header. The asset is read from a stream, or
+/// straight out of the cached asset, in fixed-size chunks which are hashed and written in the same
+/// pass, so the body is never held in memory. The digest is written into a placeholder in the part
+/// header once the content is written.
+struct MultipartUploadFileWriter {
+
+    enum Error: Swift.Error {
+        case cannotCreateFile
+        case cannotReadContent
+        case contentLengthMismatch
+    }
+
+    static let chunkSize = 64 * 1024
+
+    /// Length of a base64 encoded MD5 digest
+    private static let digestPlaceholder = String(repeating: " ", count: 24)
+
+    let boundary: String
+
+    /// Writes the multipart body to `url`, replacing any existing file.
+    /// - parameter metadata: JSON metadata of the asset
+    /// - parameter metadataContentType: content type of the metadata part
+    /// - parameter content: stream of the asset data
+    /// - parameter contentLength: number of bytes to read from `content`
+    /// - parameter contentType: content type of the asset part
+    func write(metadata: Data, metadataContentType: String, content: InputStream, contentLength: Int, contentType: String, to url: URL) throws {
+        try write(metadata: metadata, metadataContentType: metadataContentType, contentLength: contentLength, contentType: contentType, to: url) { handle in
+            try self.copyAndHash(content, length: contentLength, into: handle)
+        }
+    }
+
+    /// Writes the multipart body of an asset handed out by the file asset cache.
+    /// The content is copied out of the cached buffer chunk by chunk, without another copy of it.
+    func write(metadata: Data, metadataContentType: String, content: Data, contentType: String, to url: URL) throws {
+        try write(metadata: metadata, metadataContentType: metadataContentType, contentLength: content.count, contentType: contentType, to: url) { handle in
+            self.copyAndHash(content, into: handle)
+        }
+    }
+
+    private func write(metadata: Data, metadataContentType: String, contentLength: Int, contentType: String, to url: URL, copyContent: (FileHandle) throws -> Data) throws {
+        guard FileManager.default.createFile(atPath: url.path, contents: nil, attributes: nil),
+              let handle = try? FileHandle(forWritingTo: url) else {
+            throw Error.cannotCreateFile
+        }
+        defer { handle.closeFile() }
+
+        do {
+            handle.write(partHeader(contentType: metadataContentType, contentLength: metadata.count))
+            handle.write(metadata)
+            handle.write(utf8("\r\n"))
+
+            handle.write(partHeader(contentType: contentType, contentLength: contentLength, digestPrefix: true))
+            let digestOffset = handle.offsetInFile
+            handle.write(utf8(MultipartUploadFileWriter.digestPlaceholder + "\r\n\r\n"))
+
+            let digest = try copyContent(handle)
+
+            handle.write(utf8("\r\n--\(boundary)--\r\n"))
+
+            handle.seek(toFileOffset: digestOffset)
+            handle.write(utf8(digest.base64EncodedString()))
+        } catch {
+            try? FileManager.default.removeItem(at: url)
+            throw error
+        }
+    }
+
+    // MARK: - Helpers
+
+    private func partHeader(contentType: String, contentLength: Int, digestPrefix: Bool = false) -> Data {
+        var header = "--\(boundary)\r\n"
+        header += "Content-Type: \(contentType)\r\n"
+        header += "Content-Length: \(contentLength)\r\n"
+        if digestPrefix {
+            header += "Content-MD5: "
+        } else {
+            header += "\r\n"
+        }
+        return utf8(header)
+    }
+
+    /// Copies `length` bytes from the stream into the file and returns their MD5 digest
+    private func copyAndHash(_ stream: InputStream, length: Int, into handle: FileHandle) throws -> Data {
+        stream.open()
+        defer { stream.close() }
+
+        var context = CC_MD5_CTX()
+        CC_MD5_Init(&context)
+
+        var buffer = [UInt8](repeating: 0, count: MultipartUploadFileWriter.chunkSize)
+        var remaining = length
+
+        while remaining > 0 {
+            let read = stream.read(&buffer, maxLength: min(buffer.count, remaining))
+            guard read > 0 else {
+                throw read < 0 ? Error.cannotReadContent : Error.contentLengthMismatch
+            }
+            CC_MD5_Update(&context, buffer, CC_LONG(read))
+            handle.write(Data(bytes: buffer, count: read))
+            remaining -= read
+        }
+
+        var digest = [UInt8](repeating: 0, count: Int(CC_MD5_DIGEST_LENGTH))
+        CC_MD5_Final(&digest, &context)
+        return Data(digest)
+    }
+
+    /// Copies the content into the file chunk by chunk and returns its MD5 digest
+    private func copyAndHash(_ content: Data, into handle: FileHandle) -> Data {
+        var context = CC_MD5_CTX()
+        CC_MD5_Init(&context)
+
+        content.withUnsafeBytes { (bytes: UnsafeRawBufferPointer) in
+            guard let base = bytes.baseAddress else { return }
+            var offset = 0
+            while offset < bytes.count {
+                let length = min(MultipartUploadFileWriter.chunkSize, bytes.count - offset)
+                let chunk = UnsafeMutableRawPointer(mutating: base + offset)
+                CC_MD5_Update(&context, chunk, CC_LONG(length))
+                handle.write(Data(bytesNoCopy: chunk, count: length, deallocator: .none))
+                offset += length
+            }
+        }
+
+        var digest = [UInt8](repeating: 0, count: Int(CC_MD5_DIGEST_LENGTH))
+        CC_MD5_Final(&digest, &context)
+        return Data(digest)
+    }
+
+    private func utf8(_ string: String) -> Data {
+        return Data(string.utf8)
+    }
+}
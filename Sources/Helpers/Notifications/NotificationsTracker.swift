@@ -4,11 +4,13 @@
 import Foundation
 import WireDataModel
 
+private let notificationsProcessingEventName = "notifications.processing"
+
 @objcMembers public class NotificationsTracker: NSObject {
 
-    public let eventName = "notifications.processing"
+    public let eventName = notificationsProcessingEventName
 
-    public enum Attributes: String {
+    public enum Attributes: String, CaseIterable {
         case startedProcessing
         case startedFetchingStream
         case finishedFetchingStream
@@ -21,11 +23,29 @@ import WireDataModel
             return "notifications_" + rawValue
         }
     }
-    private let isolationQueue = DispatchQueue(label: "NotificationsProcessing")
 
-    weak var analytics: AnalyticsType?
-    @objc public init(analytics: AnalyticsType) {
-        self.analytics = analytics
+    var analytics: AnalyticsType? {
+        return metrics.analytics
+    }
+
+    /// Counts are kept in memory and added to the persisted attributes of the event when the
+    /// processing of a notification ends, instead of reading and writing them on each increment
+    private let metrics: Metrics
+    private let counters: [Attributes: MetricsCounter]
+
+    /// Sets `analytics` as the storage of the shared metrics, so that the metrics reported by the
+    /// rest of the framework are flushed to it as well
+    @objc public convenience init(analytics: AnalyticsType) {
+        self.init(analytics: analytics, metrics: .shared)
+    }
+
+    init(analytics: AnalyticsType, metrics: Metrics) {
+        metrics.analytics = analytics
+        self.metrics = metrics
+        self.counters = Dictionary(uniqueKeysWithValues: Attributes.allCases.map {
+            ($0, metrics.counter($0.identifier, event: notificationsProcessingEventName))
+        })
+        super.init()
     }
 
     public func registerReceivedPush() {
@@ -34,6 +54,7 @@ import WireDataModel
 
     public func registerNotificationProcessingCompleted() {
         increment(attribute: .finishedProcessing)
+        metrics.flush()
     }
 
     public func registerFinishStreamFetching() {
@@ -46,38 +67,30 @@ import WireDataModel
 
     public func registerProcessingExpired() {
         increment(attribute: .processingExpired)
+        metrics.flush()
     }
     
     public func registerProcessingAborted() {
         increment(attribute: .abortedProcessing)
+        metrics.flush()
     }
 
     public func registerTokenMismatch() {
         increment(attribute: .tokenMismatch)
     }
 
-    private func increment(attribute: Attributes, by amount: Double = 1) {
-        isolationQueue.sync {
-            var currentAttributes = analytics?.persistedAttributes(for: eventName) ?? [:]
-            var value = (currentAttributes[attribute.identifier] as? Double) ?? 0
-            value += amount
-            currentAttributes[attribute.identifier] = value as NSObject
-            analytics?.setPersistedAttributes(currentAttributes, for: eventName)
-        }
+    private func increment(attribute: Attributes, by amount: Int64 = 1) {
+        counters[attribute]?.increment(by: amount)
     }
 
     public func dispatchEvent() {
-        isolationQueue.sync {
-            if let analytics = analytics, let attributes = analytics.persistedAttributes(for: eventName), !attributes.isEmpty {
-                analytics.tagEvent(eventName, attributes: attributes)
-                analytics.setPersistedAttributes(nil, for: eventName)
-            }
-        }
+        metrics.dispatchEvent(eventName)
     }
 }
 
 extension NotificationsTracker {
     override public var debugDescription: String {
-        return "Current values: \(analytics?.persistedAttributes(for: eventName) ?? [:])"
+        let pending = counters.map { "\($0.key.identifier): \($0.value.value)" }
+        return "Current values: \(analytics?.persistedAttributes(for: eventName) ?? [:]), not flushed yet: \(pending)"
     }
 }
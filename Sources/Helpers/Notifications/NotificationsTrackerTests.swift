@@ -0,0 +1,72 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class NotificationsTrackerTests: XCTestCase {
+
+    var analytics: MockAnalytics!
+    var sut: NotificationsTracker!
+
+    override func setUp() {
+        super.setUp()
+        analytics = MockAnalytics()
+        let metrics = Metrics(flushInterval: 1000, scheduler: TimedRequestScheduler(notificationCenter: NotificationCenter()))
+        sut = NotificationsTracker(analytics: analytics, metrics: metrics)
+    }
+
+    override func tearDown() {
+        sut = nil
+        analytics = nil
+        super.tearDown()
+    }
+
+    var persistedAttributes: [String: NSObject] {
+        return analytics.persistedAttributes(for: sut.eventName) ?? [:]
+    }
+
+    func testThatItPersistsTheCountsWhenTheProcessingCompletes() {
+        // given
+        sut.registerReceivedPush()
+        sut.registerStartStreamFetching()
+        sut.registerFinishStreamFetching()
+        XCTAssertEqual(analytics.persistedAttributesWriteCount, 0)
+
+        // when
+        sut.registerNotificationProcessingCompleted()
+
+        // then
+        XCTAssertEqual(analytics.persistedAttributesWriteCount, 1)
+        XCTAssertEqual(persistedAttributes[NotificationsTracker.Attributes.startedProcessing.identifier] as? Double, 1)
+        XCTAssertEqual(persistedAttributes[NotificationsTracker.Attributes.finishedProcessing.identifier] as? Double, 1)
+    }
+
+    func testThatItDispatchesTheCountsNotPersistedYet() {
+        // given
+        sut.registerReceivedPush()
+        sut.registerNotificationProcessingCompleted()
+        sut.registerTokenMismatch()
+
+        // when
+        sut.dispatchEvent()
+
+        // then
+        XCTAssertEqual(analytics.taggedEvents.count, 1)
+        let attributes = analytics.taggedEvents.first?.attributes ?? [:]
+        XCTAssertEqual(attributes[NotificationsTracker.Attributes.startedProcessing.identifier] as? Double, 1)
+        XCTAssertEqual(attributes[NotificationsTracker.Attributes.tokenMismatch.identifier] as? Double, 1)
+        XCTAssertTrue(persistedAttributes.isEmpty)
+    }
+
+    func testThatItUsesTheSharedMetricsByDefault() {
+        // given
+        let previousAnalytics = Metrics.shared.analytics
+        defer { Metrics.shared.analytics = previousAnalytics }
+
+        // when
+        sut = NotificationsTracker(analytics: analytics)
+
+        // then
+        XCTAssertTrue(Metrics.shared.analytics === analytics)
+    }
+}
@@ -0,0 +1,298 @@
+//
+
+import Foundation
+
+/// The lifecycle of a request, from the moment its object needed to be synced until its response was processed.
+///
+/// Times are absolute times, as returned by `CFAbsoluteTimeGetCurrent()`. The ones recorded after the request
+/// was built are marked from several queues, they are guarded by the lock of the tracer.
+@objc(ZMRequestSpan)
+public final class RequestSpan: NSObject {
+
+    /// Recorded after the request was built
+    private struct Stages {
+        var strategy: String?
+        var sentTime: CFAbsoluteTime?
+        var responseTime: CFAbsoluteTime?
+        var finishedTime: CFAbsoluteTime?
+    }
+
+    public let identifier: Int
+    /// Transcoder and entity of the object sync which built the request
+    public let name: String
+
+    /// When the object was added to the object sync, `nil` if it wasn't tracked while waiting
+    public let eligibleTime: CFAbsoluteTime?
+    /// Intervals during which the object waited for its dependencies
+    public let blockedIntervals: [(start: CFAbsoluteTime, end: CFAbsoluteTime)]
+    /// When the object sync asked the transcoder for the request, which includes e.g. encrypting it
+    public let buildStartTime: CFAbsoluteTime
+    public let builtTime: CFAbsoluteTime
+
+    private weak var tracer: RequestTracer?
+    /// The lock of the tracer, kept so that the span can still be marked after the tracer went away
+    private let lock: NSLock
+    private var stages = Stages()
+
+    fileprivate init(identifier: Int, name: String, pendingTrace: PendingTrace?, buildStartTime: CFAbsoluteTime, builtTime: CFAbsoluteTime, tracer: RequestTracer, lock: NSLock) {
+        self.identifier = identifier
+        self.name = name
+        self.eligibleTime = pendingTrace?.eligibleTime
+        self.blockedIntervals = pendingTrace?.blockedIntervals(until: buildStartTime) ?? []
+        self.buildStartTime = buildStartTime
+        self.builtTime = builtTime
+        self.tracer = tracer
+        self.lock = lock
+        super.init()
+    }
+
+    /// Strategy which returned the request
+    public internal(set) var strategy: String? {
+        get { return withLock { stages.strategy } }
+        set { withLock { stages.strategy = newValue } }
+    }
+
+    public var sentTime: CFAbsoluteTime? {
+        return withLock { stages.sentTime }
+    }
+
+    public var responseTime: CFAbsoluteTime? {
+        return withLock { stages.responseTime }
+    }
+
+    public var finishedTime: CFAbsoluteTime? {
+        return withLock { stages.finishedTime }
+    }
+
+    fileprivate func markSent() {
+        let now = CFAbsoluteTimeGetCurrent()
+        withLock { stages.sentTime = now }
+    }
+
+    /// Call when the completion handler of the request starts running
+    @objc public func markResponseReceived() {
+        let now = CFAbsoluteTimeGetCurrent()
+        withLock { stages.responseTime = now }
+    }
+
+    /// Call when the transcoder is done with the response, this completes the span
+    @objc public func markFinished() {
+        let now = CFAbsoluteTimeGetCurrent()
+        withLock { stages.finishedTime = now }
+        tracer?.complete(self)
+    }
+
+    private func withLock<T>(_ block: () -> T) -> T {
+        lock.lock()
+        defer { lock.unlock() }
+        return block()
+    }
+}
+
+/// Times recorded for an object before a request is built for it
+private final class PendingTrace {
+
+    let eligibleTime: CFAbsoluteTime
+    var blockedIntervals: [(start: CFAbsoluteTime, end: CFAbsoluteTime)] = []
+    var blockedSince: CFAbsoluteTime?
+
+    init(eligibleTime: CFAbsoluteTime) {
+        self.eligibleTime = eligibleTime
+    }
+
+    func blockedIntervals(until time: CFAbsoluteTime) -> [(start: CFAbsoluteTime, end: CFAbsoluteTime)] {
+        guard let blockedSince = blockedSince else { return blockedIntervals }
+        return blockedIntervals + [(blockedSince, time)]
+    }
+}
+
+/// Records the lifecycle of the requests built by the object syncs, to find out where the time goes between
+/// an object needing to be synced and its response being processed.
+///
+/// Completed spans are kept in a ring buffer holding the most recent ones, and can be exported in the
+/// Chrome trace event format, to be opened in `chrome://tracing` or Perfetto.
+/// While disabled, which is the default, each call only reads a flag.
+@objc(ZMRequestTracer)
+public final class RequestTracer: NSObject {
+
+    @objc(sharedTracer)
+    public static let shared = RequestTracer()
+
+    /// Maximum number of completed spans kept
+    public let capacity: Int
+
+    private let enabled = ZMAtomicGauge()
+    private let lock = NSLock()
+    private let pendingTraces = NSMapTable<NSObject, PendingTrace>.weakToStrongObjects()
+    private let spansByRequest = NSMapTable<ZMTransportRequest, RequestSpan>.weakToWeakObjects()
+    private var completedSpans: [RequestSpan?]
+    private var nextSpanIndex = 0
+    private var nextIdentifier = 1
+
+    public init(capacity: Int = 1000) {
+        self.capacity = max(capacity, 1)
+        self.completedSpans = Array(repeating: nil, count: self.capacity)
+        super.init()
+    }
+
+    @objc public var isEnabled: Bool {
+        get { return enabled.value != 0 }
+        set {
+            enabled.value = newValue ? 1 : 0
+            if !newValue {
+                lock.lock()
+                pendingTraces.removeAllObjects()
+                lock.unlock()
+            }
+        }
+    }
+
+    // MARK: - Objects
+
+    /// Call when an object is added to an object sync. Does nothing if the object is already waiting to be synced.
+    @objc(markObjectEligible:)
+    public func markEligible(_ object: NSObject) {
+        guard isEnabled else { return }
+        lock.lock()
+        defer { lock.unlock() }
+        if pendingTraces.object(forKey: object) == nil {
+            pendingTraces.setObject(PendingTrace(eligibleTime: CFAbsoluteTimeGetCurrent()), forKey: object)
+        }
+    }
+
+    /// Call when an object starts waiting for a dependency
+    @objc(markObjectBlocked:)
+    public func markBlocked(_ object: NSObject) {
+        guard isEnabled else { return }
+        lock.lock()
+        defer { lock.unlock() }
+        let now = CFAbsoluteTimeGetCurrent()
+        let trace = pendingTraces.object(forKey: object) ?? PendingTrace(eligibleTime: now)
+        pendingTraces.setObject(trace, forKey: object)
+        if trace.blockedSince == nil {
+            trace.blockedSince = now
+        }
+    }
+
+    /// Call when a dependency of an object was synced
+    @objc(markObjectUnblocked:)
+    public func markUnblocked(_ object: NSObject) {
+        guard isEnabled else { return }
+        lock.lock()
+        defer { lock.unlock() }
+        guard let trace = pendingTraces.object(forKey: object), let blockedSince = trace.blockedSince else { return }
+        trace.blockedIntervals.append((blockedSince, CFAbsoluteTimeGetCurrent()))
+        trace.blockedSince = nil
+    }
+
+    // MARK: - Requests
+
+    /// Starts the span of a request built for the object, returns `nil` when disabled. `buildStartTime` is taken
+    /// before asking the transcoder for the request. The span should be marked when the response arrives and when it was processed.
+    @objc(beginSpanForRequest:object:transcoder:entityName:buildStartTime:groupQueue:)
+    public func beginSpan(for request: ZMTransportRequest, object: NSObject?, transcoder: AnyObject?, entityName: String?, buildStartTime: CFAbsoluteTime, groupQueue: ZMSGroupQueue) -> RequestSpan? {
+        guard isEnabled else { return nil }
+
+        let name = [transcoder.map { String(describing: type(of: $0)) }, entityName].compactMap { $0 }.joined(separator: " ")
+        let builtTime = CFAbsoluteTimeGetCurrent()
+
+        lock.lock()
+        let pendingTrace = object.flatMap { pendingTraces.object(forKey: $0) }
+        object.map { pendingTraces.removeObject(forKey: $0) }
+        let span = RequestSpan(identifier: nextIdentifier,
+                               name: name,
+                               pendingTrace: pendingTrace,
+                               buildStartTime: min(buildStartTime, builtTime),
+                               builtTime: builtTime,
+                               tracer: self,
+                               lock: lock)
+        nextIdentifier += 1
+        spansByRequest.setObject(span, forKey: request)
+        lock.unlock()
+
+        request.add(ZMTaskCreatedHandler(on: groupQueue) { [weak span] _ in
+            span?.markSent()
+        })
+        return span
+    }
+
+    /// The span of a request which did not complete yet
+    @objc(spanForRequest:)
+    public func span(for request: ZMTransportRequest) -> RequestSpan? {
+        guard isEnabled else { return nil }
+        lock.lock()
+        defer { lock.unlock() }
+        return spansByRequest.object(forKey: request)
+    }
+
+    /// Records the strategy which returned the request
+    @objc(request:returnedByStrategy:)
+    public func request(_ request: ZMTransportRequest, returnedBy strategy: AnyObject) {
+        span(for: request)?.strategy = String(describing: type(of: strategy))
+    }
+
+    fileprivate func complete(_ span: RequestSpan) {
+        lock.lock()
+        defer { lock.unlock() }
+        completedSpans[nextSpanIndex] = span
+        nextSpanIndex = (nextSpanIndex + 1) % capacity
+    }
+
+    // MARK: - Export
+
+    /// Completed spans, oldest first
+    public var spans: [RequestSpan] {
+        lock.lock()
+        defer { lock.unlock() }
+        return (completedSpans[nextSpanIndex...] + completedSpans[..<nextSpanIndex]).compactMap { $0 }
+    }
+
+    @objc public func removeAllSpans() {
+        lock.lock()
+        defer { lock.unlock() }
+        completedSpans = Array(repeating: nil, count: capacity)
+        nextSpanIndex = 0
+    }
+
+    /// The completed spans in the Chrome trace event format. Each request gets its own track,
+    /// with the time it waited, was blocked, was built, was queued, was in flight and was processed.
+    @objc public func chromeTraceData() throws -> Data {
+        let events = spans.flatMap(traceEvents(for:))
+        return try JSONSerialization.data(withJSONObject: ["traceEvents": events, "displayTimeUnit": "ms"], options: [])
+    }
+
+    private func traceEvents(for span: RequestSpan) -> [[String: Any]] {
+        let start = span.eligibleTime ?? span.buildStartTime
+        let end = span.finishedTime ?? span.responseTime ?? span.builtTime
+        var arguments: [String: Any] = ["id": span.identifier]
+        if let strategy = span.strategy {
+            arguments["strategy"] = strategy
+        }
+
+        var events = [traceEvent(span.name, category: "request", start: start, end: end, span: span, arguments: arguments)]
+        events.append(traceEvent("waiting", start: start, end: span.buildStartTime, span: span))
+        events += span.blockedIntervals.map { traceEvent("blocked", start: $0.start, end: $0.end, span: span) }
+        events.append(traceEvent("building", start: span.buildStartTime, end: span.builtTime, span: span))
+        if let sentTime = span.sentTime {
+            events.append(traceEvent("queued", start: span.builtTime, end: sentTime, span: span))
+        }
+        if let responseTime = span.responseTime {
+            events.append(traceEvent("in flight", start: span.sentTime ?? span.builtTime, end: responseTime, span: span))
+            events.append(traceEvent("processing", start: responseTime, end: span.finishedTime ?? responseTime, span: span))
+        }
+        return events.filter { ($0["dur"] as? Int64 ?? 0) > 0 || $0["cat"] as? String == "request" }
+    }
+
+    private func traceEvent(_ name: String, category: String = "stage", start: CFAbsoluteTime, end: CFAbsoluteTime, span: RequestSpan, arguments: [String: Any] = [:]) -> [String: Any] {
+        return [
+            "name": name,
+            "cat": category,
+            "ph": "X",
+            "ts": Int64(start * 1_000_000),
+            "dur": Int64((end - start) * 1_000_000),
+            "pid": 1,
+            "tid": span.identifier,
+            "args": arguments
+        ]
+    }
+}
@@ -0,0 +1,144 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class RequestTracerTests: MessagingTestBase {
+
+    var sut: RequestTracer!
+
+    override func setUp() {
+        super.setUp()
+        sut = RequestTracer(capacity: 2)
+        sut.isEnabled = true
+    }
+
+    override func tearDown() {
+        sut = nil
+        super.tearDown()
+    }
+
+    func beginSpan(for object: NSObject? = nil, buildStartTime: CFAbsoluteTime = CFAbsoluteTimeGetCurrent()) -> RequestSpan? {
+        let request = ZMTransportRequest(getFromPath: "/path")
+        return sut.beginSpan(for: request, object: object, transcoder: self, entityName: "Entity", buildStartTime: buildStartTime, groupQueue: syncMOC)
+    }
+
+    func testThatItDoesNotRecordSpansWhenDisabled() {
+        // given
+        sut.isEnabled = false
+
+        // when
+        let span = beginSpan()
+
+        // then
+        XCTAssertNil(span)
+        XCTAssertTrue(sut.spans.isEmpty)
+    }
+
+    func testThatTheSpanContainsTheTimesTheObjectWaitedForDependencies() {
+        // given
+        let object = NSObject()
+        sut.markEligible(object)
+        sut.markBlocked(object)
+        sut.markUnblocked(object)
+
+        // when
+        let span = beginSpan(for: object)
+
+        // then
+        XCTAssertNotNil(span?.eligibleTime)
+        XCTAssertEqual(span?.blockedIntervals.count, 1)
+        XCTAssertEqual(span?.name, "RequestTracerTests Entity")
+        XCTAssertLessThanOrEqual(span!.eligibleTime!, span!.blockedIntervals[0].start)
+        XCTAssertLessThanOrEqual(span!.blockedIntervals[0].end, span!.buildStartTime)
+    }
+
+    func testThatTheTimeSpentBuildingTheRequestIsNotCountedAsWaiting() throws {
+        // given
+        let object = NSObject()
+        sut.markEligible(object)
+        let buildStartTime = CFAbsoluteTimeGetCurrent()
+        Thread.sleep(forTimeInterval: 0.002)
+
+        // when
+        let span = beginSpan(for: object, buildStartTime: buildStartTime)
+        span?.markResponseReceived()
+        span?.markFinished()
+
+        // then
+        XCTAssertEqual(span?.buildStartTime, buildStartTime)
+        let json = try JSONSerialization.jsonObject(with: sut.chromeTraceData()) as? [String: Any]
+        let events = json?["traceEvents"] as? [[String: Any]] ?? []
+        let building = events.first { $0["name"] as? String == "building" }
+        XCTAssertGreaterThanOrEqual(building?["dur"] as? Int64 ?? 0, 2000)
+        let waiting = events.first { $0["name"] as? String == "waiting" }
+        XCTAssertLessThan(waiting?["dur"] as? Int64 ?? 0, 2000)
+    }
+
+    func testThatItKeepsTheEligibleTimeOfAnObjectAddedAgain() {
+        // given
+        let object = NSObject()
+        sut.markEligible(object)
+        let firstSpan = beginSpan(for: object)
+        sut.markEligible(object)
+        let secondSpan = beginSpan(for: object)
+
+        // then
+        XCTAssertNotNil(firstSpan?.eligibleTime)
+        XCTAssertGreaterThanOrEqual(secondSpan!.eligibleTime!, firstSpan!.builtTime)
+    }
+
+    func testThatItKeepsTheMostRecentCompletedSpans() {
+        // given
+        let spans = (0..<3).compactMap { _ in beginSpan() }
+
+        // when
+        spans.forEach {
+            $0.markResponseReceived()
+            $0.markFinished()
+        }
+
+        // then
+        XCTAssertEqual(sut.spans.map { $0.identifier }, spans.suffix(2).map { $0.identifier })
+    }
+
+    func testThatItMarksAndExportsSpansFromManyThreads() throws {
+        // given
+        let spans = (0..<100).compactMap { _ in beginSpan() }
+
+        // when
+        DispatchQueue.concurrentPerform(iterations: spans.count) { index in
+            spans[index].strategy = "Strategy"
+            spans[index].markResponseReceived()
+            spans[index].markFinished()
+            _ = try? sut.chromeTraceData()
+        }
+
+        // then
+        XCTAssertEqual(sut.spans.count, 2)
+        XCTAssertTrue(sut.spans.allSatisfy { $0.strategy == "Strategy" && $0.finishedTime != nil })
+    }
+
+    func testThatItExportsTheSpansInTheChromeTraceFormat() throws {
+        // given
+        let object = NSObject()
+        sut.markEligible(object)
+        let span = beginSpan(for: object)
+        Thread.sleep(forTimeInterval: 0.001)
+        span?.markResponseReceived()
+        Thread.sleep(forTimeInterval: 0.001)
+        span?.markFinished()
+
+        // when
+        let data = try sut.chromeTraceData()
+
+        // then
+        let json = try JSONSerialization.jsonObject(with: data) as? [String: Any]
+        let events = json?["traceEvents"] as? [[String: Any]] ?? []
+        XCTAssertEqual(events.first?["name"] as? String, "RequestTracerTests Entity")
+        XCTAssertTrue(events.allSatisfy { $0["ph"] as? String == "X" && $0["tid"] as? Int == span?.identifier })
+        let stages = Set(events.dropFirst().compactMap { $0["name"] as? String })
+        XCTAssertTrue(stages.isSuperset(of: ["in flight", "processing"]))
+        XCTAssertFalse(stages.contains("blocked"))
+    }
+}
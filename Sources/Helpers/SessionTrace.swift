@@ -0,0 +1,235 @@
+//
+
+import Foundation
+
+private let zmLog = ZMSLog(tag: "SessionRecorder")
+
+private let methodNames: [ZMTransportRequestMethod: String] = [
+    .methodGET: "GET",
+    .methodPOST: "POST",
+    .methodPUT: "PUT",
+    .methodDELETE: "DELETE",
+    .methodHEAD: "HEAD"
+]
+
+/// A session recorded to be replayed offline through the strategies, e.g. to benchmark them.
+///
+/// It contains the steps of the session in order, the decrypted update events received and the
+/// local changes made, and the responses to the requests sent during the session.
+public struct SessionTrace {
+
+    public static let version = 1
+
+    public enum Step {
+        /// A batch of decrypted update events, as passed to the event consumers
+        case updateEvents([RecordedEvent])
+        /// A change made by the user, replayed by the change registered under this name
+        case localChange(String)
+    }
+
+    public struct RecordedEvent {
+        public let payload: NSDictionary
+        public let uuid: UUID?
+
+        public init(payload: NSDictionary, uuid: UUID?) {
+            self.payload = payload
+            self.uuid = uuid
+        }
+
+        /// The event as it was passed to the event consumers
+        public var updateEvent: ZMUpdateEvent? {
+            return ZMUpdateEvent.decryptedUpdateEvent(fromEventStreamPayload: payload, uuid: uuid, transient: false, source: .webSocket)
+        }
+    }
+
+    public struct RecordedResponse {
+        public let method: ZMTransportRequestMethod
+        public let path: String
+        public let httpStatus: Int
+        /// `nil` for empty and binary responses
+        public let payload: ZMTransportData?
+        /// Time between the strategy returning the request and its response arriving
+        public let latency: TimeInterval
+
+        public init(method: ZMTransportRequestMethod, path: String, httpStatus: Int, payload: ZMTransportData?, latency: TimeInterval) {
+            self.method = method
+            self.path = path
+            self.httpStatus = httpStatus
+            self.payload = payload
+            self.latency = latency
+        }
+    }
+
+    public var steps: [Step]
+    public var responses: [RecordedResponse]
+
+    public init(steps: [Step] = [], responses: [RecordedResponse] = []) {
+        self.steps = steps
+        self.responses = responses
+    }
+
+    // MARK: - Serialization
+
+    public enum SerializationError: Error {
+        case invalidFormat
+        case unsupportedVersion(Int)
+    }
+
+    public init(data: Data) throws {
+        guard let trace = try JSONSerialization.jsonObject(with: data) as? [String: Any] else {
+            throw SerializationError.invalidFormat
+        }
+        guard let version = trace["version"] as? Int, version == SessionTrace.version else {
+            throw SerializationError.unsupportedVersion(trace["version"] as? Int ?? 0)
+        }
+
+        let steps = try (trace["steps"] as? [[String: Any]] ?? []).map { step -> Step in
+            switch step["type"] as? String {
+            case "events"?:
+                let events = (step["events"] as? [[String: Any]] ?? []).compactMap { event -> RecordedEvent? in
+                    guard let payload = event["payload"] as? NSDictionary else { return nil }
+                    return RecordedEvent(payload: payload, uuid: (event["uuid"] as? String).flatMap(UUID.init(uuidString:)))
+                }
+                return .updateEvents(events)
+            case "local_change"?:
+                guard let name = step["name"] as? String else { throw SerializationError.invalidFormat }
+                return .localChange(name)
+            default:
+                throw SerializationError.invalidFormat
+            }
+        }
+
+        let responses = try (trace["responses"] as? [[String: Any]] ?? []).map { response -> RecordedResponse in
+            guard
+                let methodName = response["method"] as? String,
+                let method = methodNames.first(where: { $0.value == methodName })?.key,
+                let path = response["path"] as? String,
+                let httpStatus = response["status"] as? Int
+            else {
+                throw SerializationError.invalidFormat
+            }
+            return RecordedResponse(method: method,
+                                    path: path,
+                                    httpStatus: httpStatus,
+                                    payload: response["payload"] as? ZMTransportData,
+                                    latency: response["latency"] as? TimeInterval ?? 0)
+        }
+
+        self.init(steps: steps, responses: responses)
+    }
+
+    public func data() throws -> Data {
+        let steps = self.steps.map { step -> [String: Any] in
+            switch step {
+            case .updateEvents(let events):
+                return ["type": "events", "events": events.map { event -> [String: Any] in
+                    var dictionary: [String: Any] = ["payload": event.payload]
+                    dictionary["uuid"] = event.uuid?.transportString()
+                    return dictionary
+                }]
+            case .localChange(let name):
+                return ["type": "local_change", "name": name]
+            }
+        }
+
+        let responses = self.responses.map { response -> [String: Any] in
+            var dictionary: [String: Any] = [
+                "method": methodNames[response.method] ?? "GET",
+                "path": response.path,
+                "status": response.httpStatus,
+                "latency": response.latency
+            ]
+            dictionary["payload"] = response.payload
+            return dictionary
+        }
+
+        return try JSONSerialization.data(withJSONObject: ["version": SessionTrace.version, "steps": steps, "responses": responses], options: [])
+    }
+}
+
+/// Records the session as a `SessionTrace`, while recording is started.
+///
+/// The decrypted events forwarded by the `EventDecoder` and the responses to the requests returned by
+/// the request strategies are recorded automatically, local changes have to be reported by the app.
+/// While not recording, which is the default, each call only reads a flag.
+@objc(ZMSessionRecorder)
+public final class SessionRecorder: NSObject {
+
+    @objc(sharedRecorder)
+    public static let shared = SessionRecorder()
+
+    private let recording = ZMAtomicGauge()
+    private let lock = NSLock()
+    private var trace = SessionTrace()
+
+    @objc public var isRecording: Bool {
+        return recording.value != 0
+    }
+
+    /// Starts recording a new trace, dropping the one recorded before
+    @objc public func startRecording() {
+        lock.lock()
+        defer { lock.unlock() }
+        trace = SessionTrace()
+        recording.value = 1
+    }
+
+    /// Stops recording and returns the trace recorded since recording started
+    @discardableResult
+    public func stopRecording() -> SessionTrace {
+        lock.lock()
+        defer { lock.unlock() }
+        recording.value = 0
+        return trace
+    }
+
+    @objc(recordUpdateEvents:)
+    public func record(_ events: [ZMUpdateEvent]) {
+        guard isRecording, !events.isEmpty else { return }
+        let recordedEvents = events.map { SessionTrace.RecordedEvent(payload: $0.payload as NSDictionary, uuid: $0.uuid) }
+        append(.updateEvents(recordedEvents))
+    }
+
+    /// Records a change made by the user, e.g. sending a message, to be replayed by the change registered under this name
+    @objc(recordLocalChangeNamed:)
+    public func recordLocalChange(named name: String) {
+        guard isRecording else { return }
+        append(.localChange(name))
+    }
+
+    /// Records the response of the request when it arrives
+    @objc(recordResponseToRequest:groupQueue:)
+    public func recordResponse(to request: ZMTransportRequest, groupQueue: ZMSGroupQueue) {
+        guard isRecording else { return }
+        let startTime = CFAbsoluteTimeGetCurrent()
+        let (method, path) = (request.method, request.path)
+        request.add(ZMCompletionHandler(on: groupQueue) { [weak self] response in
+            let payload = response.payload.flatMap { JSONSerialization.isValidJSONObject($0) ? $0 : nil }
+            if response.payload != nil && payload == nil {
+                zmLog.debug("Not recording the payload of the response to \(path)")
+            }
+            let recordedResponse = SessionTrace.RecordedResponse(method: method,
+                                                                 path: path,
+                                                                 httpStatus: response.httpStatus,
+                                                                 payload: payload,
+                                                                 latency: CFAbsoluteTimeGetCurrent() - startTime)
+            self?.append(recordedResponse)
+        })
+    }
+
+    // MARK: - Helpers
+
+    private func append(_ step: SessionTrace.Step) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard isRecording else { return }
+        trace.steps.append(step)
+    }
+
+    private func append(_ response: SessionTrace.RecordedResponse) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard isRecording else { return }
+        trace.responses.append(response)
+    }
+}
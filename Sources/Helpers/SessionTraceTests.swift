@@ -0,0 +1,99 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class SessionTraceTests: MessagingTestBase {
+
+    var sut: SessionRecorder!
+
+    override func setUp() {
+        super.setUp()
+        sut = SessionRecorder()
+    }
+
+    override func tearDown() {
+        sut.stopRecording()
+        sut = nil
+        super.tearDown()
+    }
+
+    func createEvent() -> ZMUpdateEvent {
+        let payload = [
+            "type": "conversation.member-update",
+            "conversation": UUID.create().transportString(),
+            "data": ["otr_muted": true],
+            "time": Date().transportString()
+        ] as NSDictionary
+        return ZMUpdateEvent.decryptedUpdateEvent(fromEventStreamPayload: payload, uuid: UUID.create(), transient: false, source: .webSocket)!
+    }
+
+    func testThatItReadsTheTraceItWrote() throws {
+        // given
+        let event = createEvent()
+        let response = SessionTrace.RecordedResponse(method: .methodPOST, path: "/conversations", httpStatus: 201, payload: ["id": "abc"] as NSDictionary, latency: 0.25)
+        let trace = SessionTrace(steps: [.updateEvents([SessionTrace.RecordedEvent(payload: event.payload as NSDictionary, uuid: event.uuid)]), .localChange("change")],
+                                 responses: [response])
+
+        // when
+        let readTrace = try SessionTrace(data: trace.data())
+
+        // then
+        XCTAssertEqual(readTrace.steps.count, 2)
+        guard case .updateEvents(let events)? = readTrace.steps.first, case .localChange(let name) = readTrace.steps[1] else {
+            return XCTFail("Unexpected steps")
+        }
+        XCTAssertEqual(events.first?.updateEvent?.uuid, event.uuid)
+        XCTAssertEqual(events.first?.updateEvent?.type, event.type)
+        XCTAssertEqual(name, "change")
+        XCTAssertEqual(readTrace.responses.first?.method, .methodPOST)
+        XCTAssertEqual(readTrace.responses.first?.path, "/conversations")
+        XCTAssertEqual(readTrace.responses.first?.httpStatus, 201)
+        XCTAssertEqual(readTrace.responses.first?.latency, 0.25)
+        XCTAssertEqual((readTrace.responses.first?.payload as? [String: String])?["id"], "abc")
+    }
+
+    func testThatItDoesNotRecordWhenNotRecording() {
+        // when
+        sut.record([createEvent()])
+        sut.recordLocalChange(named: "change")
+
+        // then
+        XCTAssertTrue(sut.stopRecording().steps.isEmpty)
+    }
+
+    func testThatItRecordsTheStepsInOrder() {
+        // given
+        sut.startRecording()
+
+        // when
+        sut.recordLocalChange(named: "change")
+        sut.record([createEvent(), createEvent()])
+
+        // then
+        let trace = sut.stopRecording()
+        XCTAssertEqual(trace.steps.count, 2)
+        guard case .localChange? = trace.steps.first, case .updateEvents(let events) = trace.steps[1] else {
+            return XCTFail("Unexpected steps")
+        }
+        XCTAssertEqual(events.count, 2)
+    }
+
+    func testThatItRecordsTheResponseOfARequest() {
+        // given
+        sut.startRecording()
+        let request = ZMTransportRequest(getFromPath: "/self")
+
+        // when
+        sut.recordResponse(to: request, groupQueue: syncMOC)
+        request.complete(with: ZMTransportResponse(payload: ["name": "Alice"] as NSDictionary, httpStatus: 200, transportSessionError: nil))
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+
+        // then
+        let response = sut.stopRecording().responses.first
+        XCTAssertEqual(response?.path, "/self")
+        XCTAssertEqual(response?.method, .methodGET)
+        XCTAssertEqual(response?.httpStatus, 200)
+        XCTAssertEqual((response?.payload as? [String: String])?["name"], "Alice")
+    }
+}
@@ -0,0 +1,39 @@
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A counter which can be incremented from any thread without taking a lock.
+///
+/// The count is split in stripes on separate cache lines and each thread adds to the stripe
+/// it hashes to, so that threads counting at the same time don't contend for the same memory.
+@interface ZMAtomicCounter : NSObject
+
+/// Creates a counter with one stripe per active core
+- (instancetype)init;
+
+- (instancetype)initWithStripeCount:(NSUInteger)stripeCount NS_DESIGNATED_INITIALIZER;
+
+- (void)add:(int64_t)amount;
+
+/// Sum of all stripes, not a consistent snapshot while other threads are adding
+@property (nonatomic, readonly) int64_t value;
+
+/// Resets the counter and returns the amount that was added since the last time it was drained
+- (int64_t)drain;
+
+@end
+
+
+/// A value which can be read and written from any thread without taking a lock
+@interface ZMAtomicGauge : NSObject
+
+@property (nonatomic) int64_t value;
+
+- (void)add:(int64_t)amount;
+
+@end
+
+NS_ASSUME_NONNULL_END
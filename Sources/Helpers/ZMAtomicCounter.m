@@ -0,0 +1,109 @@
+//
+
+
+#import "ZMAtomicCounter.h"
+#import <stdatomic.h>
+#import <pthread.h>
+#import <stdlib.h>
+
+/// Size of a cache line, stripes are padded to it to avoid false sharing
+enum { ZMAtomicCounterCacheLineSize = 64 };
+
+typedef struct {
+    _Atomic(int64_t) value;
+    char padding[ZMAtomicCounterCacheLineSize - sizeof(_Atomic(int64_t))];
+} ZMAtomicCounterStripe;
+
+static inline ZMAtomicCounterStripe *ZMAtomicCounterStripeForCurrentThread(ZMAtomicCounterStripe *stripes, NSUInteger stripeCount)
+{
+    if (stripeCount == 1) {
+        return stripes;
+    }
+    // Thread structures are aligned, so the low bits of their address are the same for all threads
+    uintptr_t thread = (uintptr_t)pthread_self();
+    uintptr_t hash = (thread >> 12) ^ (thread >> 4);
+    return &stripes[hash % stripeCount];
+}
+
+
+@implementation ZMAtomicCounter
+{
+    // ivars rather than properties to keep message sends off the counting path
+    ZMAtomicCounterStripe *_stripes;
+    NSUInteger _stripeCount;
+}
+
+- (instancetype)init
+{
+    return [self initWithStripeCount:NSProcessInfo.processInfo.activeProcessorCount];
+}
+
+- (instancetype)initWithStripeCount:(NSUInteger)stripeCount
+{
+    self = [super init];
+    if (self) {
+        _stripeCount = MAX(stripeCount, 1u);
+        void *stripes = NULL;
+        if (posix_memalign(&stripes, ZMAtomicCounterCacheLineSize, _stripeCount * sizeof(ZMAtomicCounterStripe)) != 0) {
+            return nil;
+        }
+        _stripes = stripes;
+        for (NSUInteger i = 0; i < _stripeCount; ++i) {
+            atomic_init(&_stripes[i].value, 0);
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_stripes);
+}
+
+- (void)add:(int64_t)amount
+{
+    atomic_fetch_add_explicit(&ZMAtomicCounterStripeForCurrentThread(_stripes, _stripeCount)->value, amount, memory_order_relaxed);
+}
+
+- (int64_t)value
+{
+    int64_t sum = 0;
+    for (NSUInteger i = 0; i < _stripeCount; ++i) {
+        sum += atomic_load_explicit(&_stripes[i].value, memory_order_relaxed);
+    }
+    return sum;
+}
+
+- (int64_t)drain
+{
+    int64_t sum = 0;
+    for (NSUInteger i = 0; i < _stripeCount; ++i) {
+        sum += atomic_exchange_explicit(&_stripes[i].value, 0, memory_order_relaxed);
+    }
+    return sum;
+}
+
+@end
+
+
+@implementation ZMAtomicGauge
+{
+    _Atomic(int64_t) _value;
+}
+
+- (int64_t)value
+{
+    return atomic_load_explicit(&_value, memory_order_relaxed);
+}
+
+- (void)setValue:(int64_t)value
+{
+    atomic_store_explicit(&_value, value, memory_order_relaxed);
+}
+
+- (void)add:(int64_t)amount
+{
+    atomic_fetch_add_explicit(&_value, amount, memory_order_relaxed);
+}
+
+@end
@@ -22,6 +22,19 @@
 /// Date of last call to `resetFetching`
 @property (nonatomic, readonly) NSDate *lastResetFetchDate;
 
+/// Maximum number of pages that are requested or received but not processed yet, defaults to 1.
+/// When greater than 1 and the transcoder implements @c nextUUIDWithoutProcessingResponse:forListPaginator:,
+/// the next page is requested as soon as a page is received and the received pages are processed in order afterwards.
+@property (nonatomic) NSUInteger maxOutstandingPages;
+
+/// When set, the starting point following the last processed page is stored in the store metadata under this key,
+/// and `resetFetching` resumes from there if the previous fetch did not complete.
+/// The stored starting point only applies to the self user and client that stored it.
+@property (nonatomic, copy) NSString *cursorPersistenceKey;
+
+/// Time after which a stored starting point is ignored and the fetch starts from the beginning, defaults to one day
+@property (nonatomic) NSTimeInterval cursorLifetime;
+
 
 - (instancetype)initWithBasePath:(NSString *)basePath
                         startKey:(NSString *)startKey
@@ -49,6 +62,11 @@
 @optional
 - (NSUUID *)startUUID;
 
+/// Returns the next UUID to be used as the starting point for the next request without processing the response,
+/// which will be passed to @c nextUUIDFromResponse:forListPaginator: later on
+@optional
+- (NSUUID *)nextUUIDWithoutProcessingResponse:(ZMTransportResponse *)response forListPaginator:(ZMSimpleListRequestPaginator *)paginator;
+
 /// Returns YES, if the error response for a specific statusCode should be parsed (e.g. if the payload contains content that needs to be processed)
 @optional
 - (BOOL)shouldParseErrorForResponse:(ZMTransportResponse*)response;
@@ -9,6 +9,10 @@
 #import <WireRequestStrategy/WireRequestStrategy-Swift.h>
 #import "ZMSingleRequestSync.h"
 
+static NSString * const StoredCursorKey = @"cursor";
+static NSString * const StoredCursorDateKey = @"date";
+static NSString * const StoredCursorScopeKey = @"scope";
+
 @interface ZMSimpleListRequestPaginator () <ZMSingleRequestTranscoder>
 
 @property (nonatomic, copy) NSString *basePath;
@@ -25,6 +29,10 @@
 @property (nonatomic, weak) id<ZMSimpleListRequestPaginatorSync> transcoder;
 
 @property (nonatomic) BOOL inProgress;
+
+/// Pages which were received but not processed yet
+@property (nonatomic) NSMutableArray<ZMTransportResponse *> *pendingPages;
+@property (nonatomic) BOOL isProcessingPendingPages;
 @end
 
 
@@ -50,6 +58,9 @@ ZM_EMPTY_ASSERTING_INIT()
         self.moc = moc;
         self.includeClientID = includeClientID;
         self.transcoder = transcoder;
+        self.maxOutstandingPages = 1;
+        self.cursorLifetime = 24 * 60 * 60;
+        self.pendingPages = [NSMutableArray array];
         self.singleRequestSync = [[ZMSingleRequestSync alloc] initWithSingleRequestTranscoder:self groupQueue:self.moc];
     }
     return self;
@@ -96,16 +107,19 @@ ZM_EMPTY_ASSERTING_INIT()
 
 - (void)didReceiveResponse:(ZMTransportResponse *)response forSingleRequest:(ZMSingleRequestSync * __unused)sync
 {
+    BOOL const isParsedError = response.result == ZMTransportResponseStatusPermanentError && [self shouldParseErrorForResponse:response];
+    if((response.result == ZMTransportResponseStatusSuccess || isParsedError) && self.prefetchesPages) {
+        [self enqueuePageFromResponse:response];
+        return;
+    }
+    
     if(response.result == ZMTransportResponseStatusSuccess) {
         [self updateStateWithResponse:response];
     }
     else if(response.result == ZMTransportResponseStatusPermanentError) {
-        id strongTranscoder = self.transcoder;
-        if ([strongTranscoder respondsToSelector:@selector(shouldParseErrorForResponse:)]) {
-            if ([strongTranscoder shouldParseErrorForResponse:response]) {
-                [self updateStateWithResponse:response];
-                return;
-            }
+        if (isParsedError) {
+            [self updateStateWithResponse:response];
+            return;
         }
         self.hasMoreToFetch = NO;
         self.inProgress = NO;
@@ -113,6 +127,12 @@ ZM_EMPTY_ASSERTING_INIT()
     [self.singleRequestSync readyForNextRequest];
 }
 
+- (BOOL)shouldParseErrorForResponse:(ZMTransportResponse *)response
+{
+    id strongTranscoder = self.transcoder;
+    return [strongTranscoder respondsToSelector:@selector(shouldParseErrorForResponse:)] && [strongTranscoder shouldParseErrorForResponse:response];
+}
+
 - (void)updateStateWithResponse:(ZMTransportResponse *)response
 {
     if (response == nil) {
@@ -124,6 +144,7 @@ ZM_EMPTY_ASSERTING_INIT()
     if ([strongTranscoder respondsToSelector:@selector(nextUUIDFromResponse:forListPaginator:)]) {
         self.hasMoreToFetch = [[[response.payload asDictionary] optionalNumberForKey:@"has_more"] boolValue];
         self.lastUUIDOfPreviousPage = [strongTranscoder nextUUIDFromResponse:response forListPaginator:self];
+        [self storeCursor:self.hasMoreToFetch ? self.lastUUIDOfPreviousPage : nil];
         if (!self.hasMoreToFetch) {
             self.inProgress = NO;
         }
@@ -139,13 +160,140 @@ ZM_EMPTY_ASSERTING_INIT()
     self.hasMoreToFetch = YES;
     self.lastResetFetchDate = [NSDate date];
     self.lastUUIDOfPreviousPage = nil;
+    [self.pendingPages removeAllObjects];
     id strongTranscoder = self.transcoder;
-    if ([strongTranscoder respondsToSelector:@selector(startUUID)]) {
+    NSUUID *storedCursor = self.storedCursor;
+    if (storedCursor != nil) {
+        self.lastUUIDOfPreviousPage = storedCursor;
+    }
+    else if ([strongTranscoder respondsToSelector:@selector(startUUID)]) {
         self.lastUUIDOfPreviousPage = [strongTranscoder startUUID];
     }
     [self.singleRequestSync readyForNextRequest];
 }
 
+#pragma mark - Prefetching
+
+- (BOOL)prefetchesPages
+{
+    return self.maxOutstandingPages > 1 && [self.transcoder respondsToSelector:@selector(nextUUIDWithoutProcessingResponse:forListPaginator:)];
+}
+
+/// Error responses which should be parsed are queued like pages, so that they are parsed after the pages received
+/// before them, and no page is requested after them
+- (void)enqueuePageFromResponse:(ZMTransportResponse *)response
+{
+    if (response.result == ZMTransportResponseStatusSuccess) {
+        id<ZMSimpleListRequestPaginatorSync> strongTranscoder = self.transcoder;
+        self.hasMoreToFetch = [[[response.payload asDictionary] optionalNumberForKey:@"has_more"] boolValue];
+        self.lastUUIDOfPreviousPage = [strongTranscoder nextUUIDWithoutProcessingResponse:response forListPaginator:self];
+    }
+    else {
+        self.hasMoreToFetch = NO;
+    }
+    [self.pendingPages addObject:response];
+    
+    [self requestNextPageIfPossible];
+    [self schedulePendingPagesProcessing];
+}
+
+/// Requests the next page unless there are already as many outstanding pages as allowed
+- (void)requestNextPageIfPossible
+{
+    BOOL const isRequesting = self.singleRequestSync.status == ZMSingleRequestReady || self.singleRequestSync.status == ZMSingleRequestInProgress;
+    if (!self.hasMoreToFetch || isRequesting || self.pendingPages.count >= self.maxOutstandingPages) {
+        return;
+    }
+    [self.singleRequestSync readyForNextRequest];
+    [ZMRequestAvailableNotification notifyNewRequestsAvailable:self];
+}
+
+/// Processes the pending pages one by one, in separate blocks so that the next request can be sent in between
+- (void)schedulePendingPagesProcessing
+{
+    if (self.isProcessingPendingPages) {
+        return;
+    }
+    self.isProcessingPendingPages = YES;
+    [self.moc performGroupedBlock:^{
+        [self processNextPendingPage];
+    }];
+}
+
+- (void)processNextPendingPage
+{
+    ZMTransportResponse *response = self.pendingPages.firstObject;
+    if (response == nil) {
+        self.isProcessingPendingPages = NO;
+        return;
+    }
+    [self.pendingPages removeObjectAtIndex:0];
+    
+    NSUUID *nextUUID = [self.transcoder nextUUIDFromResponse:response forListPaginator:self];
+    if (response.result != ZMTransportResponseStatusSuccess) {
+        self.lastUUIDOfPreviousPage = nextUUID;
+    }
+    BOOL const isLastPage = self.pendingPages.count == 0 && !self.hasMoreToFetch;
+    [self storeCursor:isLastPage ? nil : nextUUID];
+    if (isLastPage) {
+        self.inProgress = NO;
+    }
+    
+    [self requestNextPageIfPossible];
+    [self.moc performGroupedBlock:^{
+        [self processNextPendingPage];
+    }];
+}
+
+#pragma mark - Cursor persistence
+
+/// The stored starting point, unless it is outdated or was stored for another user or client
+- (NSUUID *)storedCursor
+{
+    if (self.cursorPersistenceKey == nil) {
+        return nil;
+    }
+    NSDictionary *stored = [self.moc persistentStoreMetadataForKey:self.cursorPersistenceKey];
+    if (![stored isKindOfClass:NSDictionary.class]) {
+        return nil;
+    }
+    NSString *cursor = stored[StoredCursorKey];
+    NSDate *date = stored[StoredCursorDateKey];
+    NSString *scope = stored[StoredCursorScopeKey];
+    BOOL const isValid = ([cursor isKindOfClass:NSString.class] &&
+                          [date isKindOfClass:NSDate.class] &&
+                          -date.timeIntervalSinceNow < self.cursorLifetime &&
+                          [scope isKindOfClass:NSString.class] &&
+                          [scope isEqualToString:self.cursorScope]);
+    return isValid ? [NSUUID uuidWithTransportString:cursor] : nil;
+}
+
+/// Stores the starting point following the last processed page, or clears it when the fetch is complete
+- (void)storeCursor:(NSUUID *)cursor
+{
+    if (self.cursorPersistenceKey == nil) {
+        return;
+    }
+    NSString *scope = self.cursorScope;
+    NSDictionary *stored = nil;
+    if (cursor != nil && scope != nil) {
+        stored = @{StoredCursorKey: cursor.transportString, StoredCursorDateKey: [NSDate date], StoredCursorScopeKey: scope};
+    }
+    [self.moc setPersistentStoreMetadata:stored forKey:self.cursorPersistenceKey];
+    [self.moc enqueueDelayedSave];
+}
+
+/// Identifies the self user and client, so that a starting point isn't used by another account or after re-registering
+- (NSString *)cursorScope
+{
+    ZMUser *selfUser = [ZMUser selfUserInContext:self.moc];
+    NSString *userID = selfUser.remoteIdentifier.transportString;
+    if (userID == nil) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@/%@", userID, selfUser.selfClient.remoteIdentifier ?: @""];
+}
+
 @end
 
 
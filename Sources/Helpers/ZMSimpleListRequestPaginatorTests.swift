@@ -0,0 +1,210 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+private class MockListPaginatorTranscoder: NSObject, ZMSimpleListRequestPaginatorSync {
+
+    var nextUUIDs: [UUID] = []
+    var processedPages = 0
+    /// Status of the paginator each time a page was processed
+    var statusWhenProcessing: [ZMSingleRequestProgress] = []
+    /// HTTP status of the processed pages, in order
+    var processedHTTPStatuses: [Int] = []
+    var parsesErrors = false
+
+    func nextUUID(from response: ZMTransportResponse!, forListPaginator paginator: ZMSimpleListRequestPaginator!) -> UUID! {
+        statusWhenProcessing.append(paginator.status)
+        processedHTTPStatuses.append(response.httpStatus)
+        processedPages += 1
+        return nextUUIDs[processedPages - 1]
+    }
+
+    func nextUUIDWithoutProcessingResponse(_ response: ZMTransportResponse!, forListPaginator paginator: ZMSimpleListRequestPaginator!) -> UUID! {
+        return nextUUIDs[processedPages]
+    }
+
+    func shouldParseError(for response: ZMTransportResponse!) -> Bool {
+        return parsesErrors
+    }
+}
+
+class ZMSimpleListRequestPaginatorTests: MessagingTestBase {
+
+    private var transcoder: MockListPaginatorTranscoder!
+
+    override func setUp() {
+        super.setUp()
+        transcoder = MockListPaginatorTranscoder()
+    }
+
+    override func tearDown() {
+        transcoder = nil
+        super.tearDown()
+    }
+
+    func createPaginator(cursorPersistenceKey: String? = nil, maxOutstandingPages: UInt = 1) -> ZMSimpleListRequestPaginator {
+        let paginator: ZMSimpleListRequestPaginator = ZMSimpleListRequestPaginator(
+            basePath: "/conversations",
+            startKey: "start",
+            pageSize: 10,
+            managedObjectContext: syncMOC,
+            includeClientID: false,
+            transcoder: transcoder)
+        paginator.cursorPersistenceKey = cursorPersistenceKey
+        paginator.maxOutstandingPages = maxOutstandingPages
+        return paginator
+    }
+
+    func completeNextRequest(of paginator: ZMSimpleListRequestPaginator, hasMore: Bool) -> ZMTransportRequest? {
+        var request: ZMTransportRequest?
+        syncMOC.performGroupedBlockAndWait {
+            request = paginator.nextRequest()
+            request?.complete(with: ZMTransportResponse(payload: ["has_more": hasMore] as NSDictionary, httpStatus: 200, transportSessionError: nil))
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        return request
+    }
+
+    func testThatItRequestsTheNextPageBeforeProcessingTheCurrentOne() {
+        // given
+        transcoder.nextUUIDs = [UUID.create(), UUID.create()]
+        let sut = createPaginator(maxOutstandingPages: 2)
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+        }
+
+        // when
+        _ = completeNextRequest(of: sut, hasMore: true)
+
+        // then
+        XCTAssertEqual(transcoder.statusWhenProcessing, [.ready])
+        syncMOC.performGroupedBlockAndWait {
+            let request = sut.nextRequest()
+            XCTAssertEqual(request?.path, "/conversations?size=10&start=\(self.transcoder.nextUUIDs[0].transportString())")
+        }
+    }
+
+    func testThatItProcessesThePagesInOrderWhenPrefetching() {
+        // given
+        transcoder.nextUUIDs = [UUID.create(), UUID.create()]
+        let sut = createPaginator(maxOutstandingPages: 2)
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+        }
+
+        // when
+        _ = completeNextRequest(of: sut, hasMore: true)
+        _ = completeNextRequest(of: sut, hasMore: false)
+
+        // then
+        XCTAssertEqual(transcoder.processedPages, 2)
+        XCTAssertFalse(sut.hasMoreToFetch)
+        XCTAssertFalse(sut.inProgress)
+    }
+
+    func testThatItResumesFromTheLastProcessedPage() {
+        // given
+        transcoder.nextUUIDs = [UUID.create()]
+        let sut = createPaginator(cursorPersistenceKey: "conversations")
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+        }
+        _ = completeNextRequest(of: sut, hasMore: true)
+
+        // when
+        let newPaginator = createPaginator(cursorPersistenceKey: "conversations")
+        var request: ZMTransportRequest?
+        syncMOC.performGroupedBlockAndWait {
+            newPaginator.resetFetching()
+            request = newPaginator.nextRequest()
+        }
+
+        // then
+        XCTAssertEqual(request?.path, "/conversations?size=10&start=\(transcoder.nextUUIDs[0].transportString())")
+    }
+
+    func testThatItStartsFromTheBeginningAfterACompletedFetch() {
+        // given
+        transcoder.nextUUIDs = [UUID.create()]
+        let sut = createPaginator(cursorPersistenceKey: "conversations")
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+        }
+        _ = completeNextRequest(of: sut, hasMore: false)
+
+        // when
+        let newPaginator = createPaginator(cursorPersistenceKey: "conversations")
+        var request: ZMTransportRequest?
+        syncMOC.performGroupedBlockAndWait {
+            newPaginator.resetFetching()
+            request = newPaginator.nextRequest()
+        }
+
+        // then
+        XCTAssertEqual(request?.path, "/conversations?size=10")
+    }
+
+    func testThatItParsesAnErrorAfterThePendingPages() {
+        // given
+        transcoder.nextUUIDs = [UUID.create(), UUID.create()]
+        transcoder.parsesErrors = true
+        let sut = createPaginator(maxOutstandingPages: 2)
+        let didReceiveResponse = NSSelectorFromString("didReceiveResponse:forSingleRequest:")
+
+        // when
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+            _ = sut.perform(didReceiveResponse, with: ZMTransportResponse(payload: ["has_more": true] as NSDictionary, httpStatus: 200, transportSessionError: nil), with: nil)
+            _ = sut.perform(didReceiveResponse, with: ZMTransportResponse(payload: ["label": "not-found"] as NSDictionary, httpStatus: 404, transportSessionError: nil), with: nil)
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+
+        // then
+        XCTAssertEqual(transcoder.processedHTTPStatuses, [200, 404])
+        XCTAssertFalse(sut.hasMoreToFetch)
+        XCTAssertFalse(sut.inProgress)
+    }
+
+    func testThatItDoesNotResumeFromAnOutdatedCursor() {
+        // given
+        transcoder.nextUUIDs = [UUID.create()]
+        let sut = createPaginator(cursorPersistenceKey: "conversations")
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+        }
+        _ = completeNextRequest(of: sut, hasMore: true)
+
+        // when
+        let newPaginator = createPaginator(cursorPersistenceKey: "conversations")
+        newPaginator.cursorLifetime = 0
+        var request: ZMTransportRequest?
+        syncMOC.performGroupedBlockAndWait {
+            newPaginator.resetFetching()
+            request = newPaginator.nextRequest()
+        }
+
+        // then
+        XCTAssertEqual(request?.path, "/conversations?size=10")
+    }
+
+    func testThatItDoesNotResumeFromACursorStoredForAnotherAccount() {
+        // given
+        let cursor = UUID.create()
+        syncMOC.performGroupedBlockAndWait {
+            let stored: [String: Any] = ["cursor": cursor.transportString(), "date": Date(), "scope": "\(UUID.create().transportString())/baddeed"]
+            self.syncMOC.setPersistentStoreMetadata(stored as NSDictionary, key: "conversations")
+        }
+
+        // when
+        let sut = createPaginator(cursorPersistenceKey: "conversations")
+        var request: ZMTransportRequest?
+        syncMOC.performGroupedBlockAndWait {
+            sut.resetFetching()
+            request = sut.nextRequest()
+        }
+
+        // then
+        XCTAssertEqual(request?.path, "/conversations?size=10")
+    }
+}
@@ -0,0 +1,106 @@
+//
+
+import Foundation
+
+private let ImagePreprocessingQueueKey = "ImagePreprocessingQueueKey"
+
+@objc(ZMImagePreprocessingPriority)
+public enum ImagePreprocessingPriority: Int {
+    /// e.g. images found in the store at launch
+    case backlog
+    /// e.g. an image the user just sent
+    case userInitiated
+}
+
+/// Schedules the preprocessing operations of image owners on an operation queue.
+///
+/// The operations of an item run with the priority it was scheduled with. The most recent
+/// user initiated item runs first, the ones scheduled before it are demoted but still run
+/// before the backlog. The operations of an item can be cancelled, e.g. when its message is deleted.
+///
+/// - note: All methods should be called from the queue of the context the items belong to
+@objcMembers public final class ImagePreprocessingScheduler: NSObject {
+
+    public let operationQueue: OperationQueue
+
+    private var operationsByItem: [NSObject: [Operation]] = [:]
+
+    public init(operationQueue: OperationQueue) {
+        self.operationQueue = operationQueue
+        super.init()
+    }
+
+    /// Creates a queue running as many preprocessing operations at the same time as
+    /// there are cores available, keeping one core free for the rest of the app
+    public static func createOperationQueue() -> OperationQueue {
+        let queue = OperationQueue()
+        queue.name = "ImagePreprocessing"
+        queue.qualityOfService = .userInitiated
+        queue.maxConcurrentOperationCount = max(1, ProcessInfo.processInfo.activeProcessorCount - 1)
+        return queue
+    }
+
+    /// Adds the operations to the queue. Operations scheduled for the same item are added to the ones it already has.
+    @objc(scheduleOperations:forItem:priority:)
+    public func schedule(_ operations: [Operation], for item: NSObject, priority: ImagePreprocessingPriority) {
+        removeFinishedOperations()
+
+        switch priority {
+        case .backlog:
+            operations.forEach { $0.queuePriority = .veryLow }
+        case .userInitiated:
+            demotePendingUserInitiatedOperations()
+            operations.forEach { $0.queuePriority = .veryHigh }
+        }
+
+        operationsByItem[item, default: []].append(contentsOf: operations)
+        operationQueue.addOperations(operations, waitUntilFinished: false)
+    }
+
+    /// Cancels the operations of the item which have not finished yet
+    @objc(cancelOperationsForItem:)
+    public func cancelOperations(for item: NSObject) {
+        operationsByItem.removeValue(forKey: item)?.forEach { $0.cancel() }
+    }
+
+    /// Whether the item has operations which have not finished yet
+    @objc(hasOperationsForItem:)
+    public func hasOperations(for item: NSObject) -> Bool {
+        return operationsByItem[item]?.contains { !$0.isFinished } ?? false
+    }
+
+    /// Cancels the operations of all items, leaving operations scheduled by others on the queue untouched
+    public func cancelAllOperations() {
+        operationsByItem.values.joined().forEach { $0.cancel() }
+        operationsByItem.removeAll()
+    }
+
+    // MARK: - Helpers
+
+    private func demotePendingUserInitiatedOperations() {
+        operationsByItem.values.joined()
+            .filter { !$0.isExecuting && !$0.isFinished && $0.queuePriority == .veryHigh }
+            .forEach { $0.queuePriority = .high }
+    }
+
+    private func removeFinishedOperations() {
+        for (item, operations) in operationsByItem {
+            let unfinished = operations.filter { !$0.isFinished }
+            operationsByItem[item] = unfinished.isEmpty ? nil : unfinished
+        }
+    }
+}
+
+extension NSManagedObjectContext {
+
+    /// The queue shared by the image preprocessors running on this context,
+    /// so that they don't use more cores than available when running at the same time
+    @objc public var imagePreprocessingQueue: OperationQueue {
+        if let queue = userInfo[ImagePreprocessingQueueKey] as? OperationQueue {
+            return queue
+        }
+        let queue = ImagePreprocessingScheduler.createOperationQueue()
+        userInfo[ImagePreprocessingQueueKey] = queue
+        return queue
+    }
+}
@@ -0,0 +1,96 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class ImagePreprocessingSchedulerTests: XCTestCase {
+
+    var queue: OperationQueue!
+    var sut: ImagePreprocessingScheduler!
+
+    override func setUp() {
+        super.setUp()
+        queue = OperationQueue()
+        queue.isSuspended = true
+        sut = ImagePreprocessingScheduler(operationQueue: queue)
+    }
+
+    override func tearDown() {
+        queue.cancelAllOperations()
+        queue.isSuspended = false
+        queue = nil
+        sut = nil
+        super.tearDown()
+    }
+
+    func testThatItRunsTheBacklogWithTheLowestPriority() {
+        // given
+        let operation = BlockOperation()
+
+        // when
+        sut.schedule([operation], for: NSObject(), priority: .backlog)
+
+        // then
+        XCTAssertEqual(operation.queuePriority, .veryLow)
+        XCTAssertEqual(queue.operationCount, 1)
+    }
+
+    func testThatItRunsTheMostRecentUserInitiatedItemFirst() {
+        // given
+        let backlogOperation = BlockOperation()
+        let firstOperation = BlockOperation()
+        let secondOperation = BlockOperation()
+        sut.schedule([backlogOperation], for: NSObject(), priority: .backlog)
+        sut.schedule([firstOperation], for: NSObject(), priority: .userInitiated)
+
+        // when
+        sut.schedule([secondOperation], for: NSObject(), priority: .userInitiated)
+
+        // then
+        XCTAssertEqual(secondOperation.queuePriority, .veryHigh)
+        XCTAssertEqual(firstOperation.queuePriority, .high)
+        XCTAssertEqual(backlogOperation.queuePriority, .veryLow)
+    }
+
+    func testThatItCancelsTheOperationsOfAnItem() {
+        // given
+        let item = NSObject()
+        let otherItem = NSObject()
+        let operations = [BlockOperation(), BlockOperation()]
+        let otherOperation = BlockOperation()
+        sut.schedule(operations, for: item, priority: .userInitiated)
+        sut.schedule([otherOperation], for: otherItem, priority: .userInitiated)
+
+        // when
+        sut.cancelOperations(for: item)
+
+        // then
+        XCTAssertTrue(operations.allSatisfy { $0.isCancelled })
+        XCTAssertFalse(otherOperation.isCancelled)
+        XCTAssertFalse(sut.hasOperations(for: item))
+        XCTAssertTrue(sut.hasOperations(for: otherItem))
+    }
+
+    func testThatCancellingAllOperationsDoesNotCancelOperationsAddedByOthers() {
+        // given
+        let operation = BlockOperation()
+        let foreignOperation = BlockOperation()
+        sut.schedule([operation], for: NSObject(), priority: .backlog)
+        queue.addOperation(foreignOperation)
+
+        // when
+        sut.cancelAllOperations()
+
+        // then
+        XCTAssertTrue(operation.isCancelled)
+        XCTAssertFalse(foreignOperation.isCancelled)
+    }
+
+    func testThatTheQueueIsSizedToTheAvailableCores() {
+        // when
+        let queue = ImagePreprocessingScheduler.createOperationQueue()
+
+        // then
+        XCTAssertEqual(queue.maxConcurrentOperationCount, max(1, ProcessInfo.processInfo.activeProcessorCount - 1))
+    }
+}
@@ -5,15 +5,18 @@
 @import WireDataModel;
 
 #import "ZMImagePreprocessingTracker+Testing.h"
+#import <WireRequestStrategy/WireRequestStrategy-Swift.h>
 
 @interface ZMImagePreprocessingTracker ()
 
 @property (nonatomic) NSManagedObjectContext *managedObjectContext;
 @property (nonatomic) id<ZMAssetsPreprocessor> preprocessor;
-@property (nonatomic) NSOperationQueue *imagePreprocessingQueue;
+@property (nonatomic) ImagePreprocessingScheduler *scheduler;
 @property (nonatomic) NSPredicate *needsPreprocessingPredicate;
 @property (nonatomic) NSPredicate *fetchPredicate;
 @property (nonatomic) Class entityClass;
+/// The image owners that need preprocessing or are being preprocessed, to check membership with a single lookup
+@property (nonatomic) NSMutableSet *trackedImageOwners;
 
 @end
 
@@ -54,7 +57,8 @@
         
         _imageOwnersBeingPreprocessed = [NSMutableSet set];
         _imageOwnersThatNeedPreprocessing = [NSMutableOrderedSet orderedSet];
-        self.imagePreprocessingQueue = imageProcessingQueue;
+        self.trackedImageOwners = [NSMutableSet set];
+        self.scheduler = [[ImagePreprocessingScheduler alloc] initWithOperationQueue:imageProcessingQueue];
         self.entityClass = entityClass;
     }
     return self;
@@ -63,7 +67,8 @@
 - (void)tearDown;
 {
     self.preprocessor = nil;
-    [self.imagePreprocessingQueue cancelAllOperations];
+    // The queue can be shared with other preprocessors, only cancel our own operations
+    [self.scheduler cancelAllOperations];
 }
 
 - (BOOL)hasOutstandingItems;
@@ -83,40 +88,60 @@
     [filteredObjects filterUsingPredicate:self.needsPreprocessingPredicate];
     NSArray *sortDescriptors = [self.entityClass defaultSortDescriptors];
     NSArray *sortedObjects = [filteredObjects sortedArrayUsingDescriptors:sortDescriptors];
-    [self.imageOwnersThatNeedPreprocessing addObjectsFromArray:sortedObjects];
-    [self enqueueAll];
+    for (id<ZMImageOwner> imageOwner in sortedObjects) {
+        [self trackImageOwner:imageOwner];
+    }
+    [self enqueueAllWithPriority:ZMImagePreprocessingPriorityBacklog];
 }
 
 - (void)objectsDidChange:(NSSet *)objects
 {
+    [self cancelPreprocessingOfDiscardedImageOwners:objects];
     [self addImageOwners:objects];
-    [self enqueueAll];
+    [self enqueueAllWithPriority:ZMImagePreprocessingPriorityUserInitiated];
+}
+
+- (void)cancelPreprocessingOfDiscardedImageOwners:(NSSet *)objects
+{
+    for (id object in objects) {
+        if (![self.imageOwnersBeingPreprocessed containsObject:object]) {
+            continue;
+        }
+        BOOL const deleted = [object isKindOfClass:NSManagedObject.class] && [(NSManagedObject *)object isDeleted];
+        BOOL const cancelled = [object isKindOfClass:ZMAssetClientMessage.class] && ((ZMAssetClientMessage *)object).transferState == ZMFileTransferStateUploadingCancelled;
+        if (deleted || cancelled) {
+            [self.scheduler cancelOperationsForItem:object];
+        }
+    }
 }
 
 - (void)addImageOwners:(NSSet *)imageOwners
 {
     for (id<ZMImageOwner> imageOwner in imageOwners) {
-        if([imageOwner isKindOfClass:self.entityClass])
+        if([imageOwner isKindOfClass:self.entityClass] && [self.needsPreprocessingPredicate evaluateWithObject:imageOwner])
         {
-            if (
-                [self.needsPreprocessingPredicate evaluateWithObject:imageOwner] &&
-                ![self.imageOwnersBeingPreprocessed containsObject:imageOwner] &&
-                ![self.imageOwnersThatNeedPreprocessing containsObject:imageOwner])
-            {
-                [self.imageOwnersThatNeedPreprocessing addObject:imageOwner];
-            }
+            [self trackImageOwner:imageOwner];
         }
     }
 }
 
-- (void)enqueueAll;
+- (void)trackImageOwner:(id<ZMImageOwner>)imageOwner
+{
+    if ([self.trackedImageOwners containsObject:imageOwner]) {
+        return;
+    }
+    [self.trackedImageOwners addObject:imageOwner];
+    [self.imageOwnersThatNeedPreprocessing addObject:imageOwner];
+}
+
+- (void)enqueueAllWithPriority:(ZMImagePreprocessingPriority)priority;
 {
-    while ([self enqueueNext]) {
+    while ([self enqueueNextWithPriority:priority]) {
         ; // nothing to do here
     }
 }
 
-- (BOOL)enqueueNext;
+- (BOOL)enqueueNextWithPriority:(ZMImagePreprocessingPriority)priority;
 {
     id<ZMImageOwner> owner = [self.imageOwnersThatNeedPreprocessing firstObject];
     if (owner == nil) {
@@ -128,6 +153,7 @@
     
     NSArray *operations = [preprocessor operationsForPreprocessingImageOwner:owner];
     if (operations == nil) {
+        [self.trackedImageOwners removeObject:owner];
         [self failedPreprocessingImageOwner:owner];
         return YES;
     }
@@ -160,11 +186,12 @@
         [self.managedObjectContext performGroupedBlock:^{
             [self didCompleteProcessingImageOwner:owner];
             [self.imageOwnersBeingPreprocessed removeObject:owner];
+            [self.trackedImageOwners removeObject:owner];
             [group leave];
         }];
     }];
     
-    [self.imagePreprocessingQueue addOperations:operations waitUntilFinished:NO];
+    [self.scheduler scheduleOperations:operations forItem:(NSObject *)owner priority:priority];
     return YES;
 }
 
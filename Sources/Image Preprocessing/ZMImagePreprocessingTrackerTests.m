@@ -112,6 +112,61 @@
     XCTAssertEqual(self.sut.imageOwnersThatNeedPreprocessing.count, 0u);
 }
 
+- (void)testThatItUsesTheBacklogPriorityForTrackedObjects
+{
+    // given
+    NSOperation *operation = [[NSOperation alloc] init];
+    ZMClientMessage *message = [[ZMClientMessage alloc] initWithNonce:NSUUID.createUUID managedObjectContext:self.testSession.uiMOC];
+    [[[self.preprocessor stub] andReturn:@[operation]] operationsForPreprocessingImageOwner:message];
+    
+    // when
+    self.imagePreprocessingQueue.suspended = YES;
+    [self.sut addTrackedObjects:[NSSet setWithObject:message]];
+    
+    // then
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityVeryLow);
+    self.imagePreprocessingQueue.suspended = NO;
+}
+
+- (void)testThatItDoesNotScheduleAnImageOwnerAgainWhileItIsBeingPreprocessed
+{
+    // given
+    NSOperation *operation = [[NSOperation alloc] init];
+    ZMClientMessage *message = [[ZMClientMessage alloc] initWithNonce:NSUUID.createUUID managedObjectContext:self.testSession.uiMOC];
+    [[[self.preprocessor stub] andReturn:@[operation]] operationsForPreprocessingImageOwner:message];
+    self.imagePreprocessingQueue.suspended = YES;
+    [self.sut objectsDidChange:[NSSet setWithObject:message]];
+    
+    // when
+    [self.sut addTrackedObjects:[NSSet setWithObject:message]];
+    [self.sut objectsDidChange:[NSSet setWithObject:message]];
+    
+    // then
+    XCTAssertEqual(self.imagePreprocessingQueue.operationCount, 1u);
+    XCTAssertTrue([self.sut.imageOwnersBeingPreprocessed containsObject:message]);
+    XCTAssertEqual(self.sut.imageOwnersThatNeedPreprocessing.count, 0u);
+    self.imagePreprocessingQueue.suspended = NO;
+}
+
+- (void)testThatItCancelsThePreprocessingOfADeletedImageOwner
+{
+    // given
+    NSOperation *operation = [[NSOperation alloc] init];
+    ZMClientMessage *message = [[ZMClientMessage alloc] initWithNonce:NSUUID.createUUID managedObjectContext:self.testSession.uiMOC];
+    [[[self.preprocessor stub] andReturn:@[operation]] operationsForPreprocessingImageOwner:message];
+    self.imagePreprocessingQueue.suspended = YES;
+    [self.sut objectsDidChange:[NSSet setWithObject:message]];
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityVeryHigh);
+    
+    // when
+    [self.testSession.uiMOC deleteObject:message];
+    [self.sut objectsDidChange:[NSSet setWithObject:message]];
+    
+    // then
+    XCTAssertTrue(operation.isCancelled);
+    self.imagePreprocessingQueue.suspended = NO;
+}
+
 @end
 
 
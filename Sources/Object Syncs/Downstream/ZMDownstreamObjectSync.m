@@ -7,6 +7,7 @@
 
 #import "ZMDownstreamObjectSync.h"
 #import "ZMSyncOperationSet.h"
+#import <WireRequestStrategy/WireRequestStrategy-Swift.h>
 
 @interface ZMDownstreamObjectSync ()
 
@@ -16,6 +17,8 @@
 @property (nonatomic) NSEntityDescription *entity;
 @property (nonatomic) NSPredicate *predicateForObjectsToDownload;
 @property (nonatomic) NSPredicate *filter; //additional optional predication to filter objectis by not persisted properties
+@property (nonatomic) ZMMetricsGauge *pendingObjectsGauge;
+@property (nonatomic) ZMMetricsHistogram *requestDuration;
 
 @end
 
@@ -72,6 +75,10 @@
         self.objectsToDownload.sortDescriptors = [NSClassFromString(self.entity.managedObjectClassName) sortDescriptorsForUpdating];
         self.predicateForObjectsToDownload = predicateForObjectsToDownload;
         self.filter = filter;
+        
+        NSString *metricsName = [NSString stringWithFormat:@"%@_%@_downstream", NSStringFromClass([transcoder class]), entityName];
+        self.pendingObjectsGauge = [ZMMetrics.sharedMetrics gaugeNamed:[metricsName stringByAppendingString:@"_pending"] event:ZMMetrics.objectSyncEvent];
+        self.requestDuration = [ZMMetrics.sharedMetrics histogramNamed:[metricsName stringByAppendingString:@"_request"] event:ZMMetrics.objectSyncEvent];
     }
     return self;
 }
@@ -88,6 +95,7 @@
 {
     for (ZMManagedObject *mo in objects) {
         if(self.filter == nil || [self.filter evaluateWithObject:mo]) {
+            [ZMRequestTracer.sharedTracer markObjectEligible:mo];
             [self.objectsToDownload addObjectToBeSynchronized:mo];
         }
     }
@@ -106,6 +114,7 @@
             continue;
         }
         if ([self needsToSyncObject:mo]) {
+            [ZMRequestTracer.sharedTracer markObjectEligible:mo];
             [self.objectsToDownload addObjectToBeSynchronized:mo];
         }
     }
@@ -114,6 +123,7 @@
 - (ZMTransportRequest *)nextRequest;
 {
     id<ZMDownstreamTranscoder> transcoder = self.transcoder;
+    self.pendingObjectsGauge.value = (int64_t)self.objectsToDownload.count;
 
     ZMManagedObject *nextObject;
     while ( (nextObject = [self.objectsToDownload nextObjectToSynchronize]) != nil) {
@@ -123,6 +133,7 @@
             continue;
         }
     
+        CFAbsoluteTime buildStartTime = CFAbsoluteTimeGetCurrent();
         ZMTransportRequest *request = [transcoder requestForFetchingObject:nextObject downstreamSync:self];
         if(request == nil) {
             [self.objectsToDownload removeObject:nextObject];
@@ -131,10 +142,20 @@
         [request setDebugInformationTranscoder:transcoder];
         
         ZMSyncToken *token = [self.objectsToDownload didStartSynchronizingKeys:nil forObject:nextObject];
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        ZMRequestSpan *span = [ZMRequestTracer.sharedTracer beginSpanForRequest:request
+                                                                         object:nextObject
+                                                                     transcoder:transcoder
+                                                                     entityName:self.entity.name
+                                                                 buildStartTime:buildStartTime
+                                                                     groupQueue:nextObject.managedObjectContext];
         ZM_WEAK(self);
         [request addCompletionHandler:[ZMCompletionHandler handlerOnGroupQueue:nextObject.managedObjectContext block:^(ZMTransportResponse *response) {
             ZM_STRONG(self);
+            [self.requestDuration recordDurationSinceTime:startTime];
+            [span markResponseReceived];
             [self processResponse:response forObject:nextObject token:token transcoder:self.transcoder];
+            [span markFinished];
         }]];
         return request;
     }
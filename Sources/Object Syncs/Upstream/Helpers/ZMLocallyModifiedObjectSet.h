@@ -26,6 +26,9 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (nonatomic, readonly, nullable) NSSet *trackedKeys;
 
+/// Number of objects waiting to be synced or being synced
+@property (nonatomic, readonly) NSUInteger count;
+
 // Init with all keys tracked
 - (instancetype)init;
 // Init with only some keys tracked
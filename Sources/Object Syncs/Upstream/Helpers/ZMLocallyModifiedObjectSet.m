@@ -174,6 +174,11 @@
     return (0 < self.objectIDsToStatus.count);
 }
 
+- (NSUInteger)count
+{
+    return self.objectIDsToStatus.count;
+}
+
 - (NSString *)debugDescription
 {
     return [NSString stringWithFormat:@"<%@: %p> hasOutstandingItems %d; %@", [self class], self, self.hasOutstandingItems, self.objectIDsToStatus];
@@ -23,6 +23,8 @@
 @property (nonatomic, readonly) BOOL transcodeSupportsExpiration;
 @property (nonatomic) NSMutableSet *ignoredObjects;
 @property (nonatomic) NSPredicate *filter;
+@property (nonatomic) ZMMetricsGauge *pendingObjectsGauge;
+@property (nonatomic) ZMMetricsHistogram *requestDuration;
 
 @end
 
@@ -66,6 +68,10 @@ static NSString* ZMLogTag = @"Network";
         if ([transcoder respondsToSelector:@selector(dependentObjectNeedingUpdateBeforeProcessingObject:)]) {
             self.insertedObjectsWithDependencies = [[DependentObjectsObjc alloc] init];
         }
+        
+        NSString *metricsName = [NSString stringWithFormat:@"%@_%@_upstream_inserted", NSStringFromClass([transcoder class]), entityName];
+        self.pendingObjectsGauge = [ZMMetrics.sharedMetrics gaugeNamed:[metricsName stringByAppendingString:@"_pending"] event:ZMMetrics.objectSyncEvent];
+        self.requestDuration = [ZMMetrics.sharedMetrics histogramNamed:[metricsName stringByAppendingString:@"_request"] event:ZMMetrics.objectSyncEvent];
     }
     return self;
 }
@@ -158,6 +164,7 @@ static NSString* ZMLogTag = @"Network";
 /// returns false if object has dependencies, adding it to insertedObjectsWithDependencies
 - (BOOL)addInsertedObject:(ZMManagedObject *)mo
 {
+    [ZMRequestTracer.sharedTracer markObjectEligible:mo];
     if (self.logPredicateActivity) {
         ZMLogInfo(@"%@: addInsertedObject for %@", self, mo);
     }
@@ -196,6 +203,7 @@ static NSString* ZMLogTag = @"Network";
 
 - (ZMTransportRequest *)processNextInsert
 {
+    self.pendingObjectsGauge.value = (int64_t)self.insertedObjects.count;
     ZMManagedObject *nextObject = [self nextObjectToSync];
     if (nextObject == nil) {
         return nil;
@@ -208,6 +216,7 @@ static NSString* ZMLogTag = @"Network";
         }
     }
     
+    CFAbsoluteTime buildStartTime = CFAbsoluteTimeGetCurrent();
     ZMUpstreamRequest *request = [transcoder requestForInsertingObject:nextObject forKeys:nil];
     
     if (request == nil) {
@@ -217,12 +226,21 @@ static NSString* ZMLogTag = @"Network";
     }
 
     [self.insertedObjects didStartSynchronizingObject:nextObject];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    ZMRequestSpan *span = [ZMRequestTracer.sharedTracer beginSpanForRequest:request.transportRequest
+                                                                     object:nextObject
+                                                                 transcoder:transcoder
+                                                                 entityName:self.trackedEntity.name
+                                                             buildStartTime:buildStartTime
+                                                                 groupQueue:nextObject.managedObjectContext];
 
     ZM_WEAK(self);
     ZM_WEAK(request);
     [request.transportRequest addCompletionHandler:[ZMCompletionHandler handlerOnGroupQueue:nextObject.managedObjectContext block:^(ZMTransportResponse *response) {
         ZM_STRONG(self);
         ZM_STRONG(request);
+        [self.requestDuration recordDurationSinceTime:startTime];
+        [span markResponseReceived];
         
         BOOL didFinish = YES;
         
@@ -267,6 +285,7 @@ static NSString* ZMLogTag = @"Network";
         }
         
         [nextObject.managedObjectContext enqueueDelayedSaveWithGroup:response.dispatchGroup];
+        [span markFinished];
     }]];
     
     return request.transportRequest;
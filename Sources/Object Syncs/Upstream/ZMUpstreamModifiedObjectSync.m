@@ -23,6 +23,8 @@
 @property (nonatomic) DependentObjectsObjc *updatedObjectsWithDependencies;
 @property (nonatomic, readonly) BOOL transcodeSupportsExpiration;
 @property (nonatomic) NSPredicate *filter;
+@property (nonatomic) ZMMetricsGauge *pendingObjectsGauge;
+@property (nonatomic) ZMMetricsHistogram *requestDuration;
 
 @end
 
@@ -109,6 +111,10 @@ ZM_EMPTY_ASSERTING_INIT();
         if ([transcoder respondsToSelector:@selector(dependentObjectNeedingUpdateBeforeProcessingObject:)]) {
             self.updatedObjectsWithDependencies = [[DependentObjectsObjc alloc] init];
         }
+        
+        NSString *metricsName = [NSString stringWithFormat:@"%@_%@_upstream_modified", NSStringFromClass([transcoder class]), entityName];
+        self.pendingObjectsGauge = [ZMMetrics.sharedMetrics gaugeNamed:[metricsName stringByAppendingString:@"_pending"] event:ZMMetrics.objectSyncEvent];
+        self.requestDuration = [ZMMetrics.sharedMetrics histogramNamed:[metricsName stringByAppendingString:@"_request"] event:ZMMetrics.objectSyncEvent];
     }
     return self;
     
@@ -188,6 +194,7 @@ ZM_EMPTY_ASSERTING_INIT();
 
 - (void)addUpdatedObject:(ZMManagedObject *)mo
 {
+    [ZMRequestTracer.sharedTracer markObjectEligible:mo];
     if (self.updatedObjectsWithDependencies) {
         id dependency = [self.transcoder dependentObjectNeedingUpdateBeforeProcessingObject:mo];
         if (dependency != nil) {
@@ -224,6 +231,7 @@ ZM_EMPTY_ASSERTING_INIT();
 
 - (ZMTransportRequest *)processNextUpdate
 {
+    self.pendingObjectsGauge.value = (int64_t)self.updatedObjects.count;
     ZMObjectWithKeys *objectWithKeys = [self nextObjectToSync];
     if (objectWithKeys == nil) {
         return nil;
@@ -236,6 +244,7 @@ ZM_EMPTY_ASSERTING_INIT();
         }
     }
 
+    CFAbsoluteTime buildStartTime = CFAbsoluteTimeGetCurrent();
     ZMUpstreamRequest *request = [transcoder requestForUpdatingObject:objectWithKeys.object forKeys:objectWithKeys.keysToSync];
     [request.transportRequest setDebugInformationTranscoder:transcoder];
     
@@ -249,12 +258,21 @@ ZM_EMPTY_ASSERTING_INIT();
     ZMModifiedObjectSyncToken *token = [self.updatedObjects didStartSynchronizingKeys:request.keys forObject:objectWithKeys];
     NSDictionary *userInfo = request.userInfo;
     NSSet *keys = request.keys;
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    ZMRequestSpan *span = [ZMRequestTracer.sharedTracer beginSpanForRequest:request.transportRequest
+                                                                     object:objectWithKeys.object
+                                                                 transcoder:transcoder
+                                                                 entityName:self.trackedEntity.name
+                                                             buildStartTime:buildStartTime
+                                                                 groupQueue:objectWithKeys.object.managedObjectContext];
     
     ZM_WEAK(self);
     ZM_WEAK(request);
     [request.transportRequest addCompletionHandler:[ZMCompletionHandler handlerOnGroupQueue: objectWithKeys.object.managedObjectContext block:^(ZMTransportResponse *response) {
         ZM_STRONG(self);
         ZM_STRONG(request);
+        [self.requestDuration recordDurationSinceTime:startTime];
+        [span markResponseReceived];
         
         id <ZMUpstreamTranscoder> localTranscoder = self.transcoder;
         NSSet *keysToParse = [self.updatedObjects keysToParseAfterSyncingToken:token];
@@ -296,7 +314,7 @@ ZM_EMPTY_ASSERTING_INIT();
             }
         }
         
-        
+        [span markFinished];
     }]];
 
     return request.transportRequest;
@@ -96,6 +96,7 @@ public class DependentObjects<Object: Hashable, Dependency: Hashable> {
     @objc(addDependentObject:dependency:)
     public func add(dependent: ZMManagedObject, dependency: ZMManagedObject) {
         self.dependentObjects.add(dependency: dependency, for: dependent)
+        RequestTracer.shared.markBlocked(dependent)
     }
     
     @objc(anyDependencyForObject:)
@@ -105,7 +106,13 @@ public class DependentObjects<Object: Hashable, Dependency: Hashable> {
     
     @objc(enumerateAndRemoveObjectsForDependency:usingBlock:)
     public func enumerateAndRemoveObjects(for dependency: ZMManagedObject, block: (ZMManagedObject)->Bool) {
-        self.dependentObjects.enumerateAndRemoveObjects(for: dependency, block: block)
+        self.dependentObjects.enumerateAndRemoveObjects(for: dependency) { dependent in
+            let shouldRemove = block(dependent)
+            if shouldRemove && RequestTracer.shared.isEnabled && self.dependentObjects.dependencies(for: dependent) == [dependency] {
+                RequestTracer.shared.markUnblocked(dependent)
+            }
+            return shouldRemove
+        }
     }
     
 }
@@ -39,4 +39,67 @@ public protocol ApplicationStatus : class {
     
     func requestSlowSync()
 
+    /// The state the request strategies are gated on. Strategies of a status that publishes it
+    /// only re-evaluate whether they are allowed to create requests when it changes.
+    @objc optional var requestGatingState: RequestGatingState { get }
+
+}
+
+/// Publishes the states of an `ApplicationStatus` that decide which request strategies are allowed
+/// to create requests, as a single word.
+///
+/// The low bits of the word are the prerequisites of `AbstractRequestStrategy.prerequisites(forApplicationStatus:)`,
+/// the high bits a generation counter incremented whenever they change. Strategies compare the word
+/// with the one of their last decision instead of reading the states again.
+/// The status owning it has to call `update(from:)` when one of these states changes, and `invalidate()`
+/// when it goes away. The word can be read from any thread, while updates are expected from the queue
+/// of the status only.
+@objc(ZMRequestGatingState)
+public final class RequestGatingState: NSObject {
+
+    static let prerequisitesMask: UInt = 0xFFFF
+    static let generationIncrement: UInt = prerequisitesMask + 1
+
+    private let storage = ZMAtomicGauge()
+
+    /// Publishes the current prerequisites of the status right away
+    @objc public init(applicationStatus: ApplicationStatus) {
+        super.init()
+        word = AbstractRequestStrategy.prerequisites(forApplicationStatus: applicationStatus).rawValue
+    }
+
+    @objc public private(set) var word: UInt {
+        get { return UInt(truncatingIfNeeded: UInt64(bitPattern: storage.value)) }
+        set { storage.value = Int64(bitPattern: UInt64(newValue)) }
+    }
+
+    @objc public var prerequisites: ZMStrategyConfigurationOption {
+        return ZMStrategyConfigurationOption(rawValue: word & RequestGatingState.prerequisitesMask)
+    }
+
+    /// Whether the status went away, see `invalidate()`
+    @objc public var isInvalidated: Bool {
+        return word & RequestGatingState.prerequisitesMask == RequestGatingState.prerequisitesMask
+    }
+
+    /// Reads the states of the status again and publishes a new word if the prerequisites changed
+    @objc(updateFromApplicationStatus:)
+    public func update(from applicationStatus: ApplicationStatus) {
+        guard !isInvalidated else { return }
+        publish(AbstractRequestStrategy.prerequisites(forApplicationStatus: applicationStatus).rawValue)
+    }
+
+    /// Publishes prerequisites no configuration covers, so that strategies stop creating requests
+    /// without checking whether their status still exists. Call from the `deinit` of the status.
+    @objc public func invalidate() {
+        publish(RequestGatingState.prerequisitesMask)
+    }
+
+    private func publish(_ prerequisites: UInt) {
+        let word = self.word
+        guard prerequisites != word & RequestGatingState.prerequisitesMask else { return }
+        let generation = (word & ~RequestGatingState.prerequisitesMask) &+ RequestGatingState.generationIncrement
+        self.word = generation | prerequisites
+    }
+
 }
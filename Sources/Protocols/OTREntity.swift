@@ -127,6 +127,7 @@ extension OTREntity {
     
     public func parseEmptyUploadResponse(_ response: ZMTransportResponse, in conversation: ZMConversation, clientRegistrationDelegate: ClientRegistrationDelegate) -> ZMConversationRemoteClientChangeSet {
         guard !detectedDeletedSelfClient(in: response) else {
+            context.removeLinkMetadataCache()
             clientRegistrationDelegate.didDetectCurrentClientDeletion()
             return [.deleted]
         }
@@ -192,6 +193,7 @@ extension OTREntity {
     /// Parse the response to an upload, that will inform us of missing, deleted and redundant clients
     public func parseUploadResponse(_ response: ZMTransportResponse, clientRegistrationDelegate: ClientRegistrationDelegate) -> ZMConversationRemoteClientChangeSet {
         guard !detectedDeletedSelfClient(in: response) else {
+            context.removeLinkMetadataCache()
             clientRegistrationDelegate.didDetectCurrentClientDeletion()
             return [.deleted]
         }
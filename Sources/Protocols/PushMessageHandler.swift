@@ -19,6 +19,14 @@ import WireDataModel
     func process(_ message: ZMMessage)
     
     
+    /// Creates notifications for a batch of received messages.
+    /// When not implemented, `process(_ message:)` is called for each message.
+    ///
+    /// - Parameter messages: messages that were received, in the order they were inserted
+    @objc(processMessages:)
+    optional func process(messages: [ZMMessage])
+    
+    
     /// Shows a notification for a failure to send
     ///
     /// - Parameter message: message that failed to send
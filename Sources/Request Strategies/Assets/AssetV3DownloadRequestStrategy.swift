@@ -12,8 +12,7 @@ fileprivate let zmLog = ZMSLog(tag: "Asset V3")
 
     fileprivate var assetDownstreamObjectSync: ZMDownstreamObjectSyncWithWhitelist!
     private var notificationTokens: [Any] = []
-
-    private typealias DecryptionKeys = (otrKey: Data, sha256: Data)
+    private let decryptor = StreamingAssetDecryptor()
     
     public override init(withManagedObjectContext managedObjectContext: NSManagedObjectContext, applicationStatus: ApplicationStatus?) {
         super.init(withManagedObjectContext: managedObjectContext, applicationStatus: applicationStatus)
@@ -78,20 +77,26 @@ fileprivate let zmLog = ZMSLog(tag: "Asset V3")
             self.applicationStatus?.requestCancellation.cancelTask(with: identifier)
             message.isDownloading = false
             message.associatedTaskIdentifier = nil
+            self.transferManager.end(AssetTransferManager.Transfer(messageID: objectID, kind: .download))
         }
     }
+    
+    var transferManager: AssetTransferManager {
+        return managedObjectContext.assetTransferManager
+    }
 
     public override func nextRequestIfAllowed() -> ZMTransportRequest? {
+        // Downloads are requested by the user, they can use the slots reserved for user initiated transfers
+        guard transferManager.canStartTransfer(priority: .userInitiated) else { return nil }
         return self.assetDownstreamObjectSync.nextRequest()
     }
 
     fileprivate func handleResponse(_ response: ZMTransportResponse, forMessage assetClientMessage: ZMAssetClientMessage) {
-        var downloadSuccess = false
-        
         assetClientMessage.isDownloading = false
         
         if response.result == .success {
-            downloadSuccess = storeAndDecrypt(data: response.rawData!, for: assetClientMessage)
+            decryptAndStore(data: response.rawData!, for: assetClientMessage)
+            return
         }
         else if response.result == .permanentError {
             zmLog.debug("asset unavailable on remote (\(response.httpStatus)), deleting")
@@ -104,50 +109,40 @@ fileprivate let zmLog = ZMSLog(tag: "Asset V3")
 
         // we've just downloaded some data, we need to refresh the category of the message.
         assetClientMessage.updateCategoryCache()
-        
-        if downloadSuccess {
-            NotificationDispatcher.notifyNonCoreDataChanges(objectID: assetClientMessage.objectID,
-                                                            changedKeys: [#keyPath(ZMAssetClientMessage.hasDownloadedFile)],
-                                                            uiContext: self.managedObjectContext.zm_userInterface!)
-        }
-    }
-
-    private func storeAndDecrypt(data: Data, for message: ZMAssetClientMessage) -> Bool {
-        guard let genericMessage = message.genericAssetMessage,
-              let asset = genericMessage.assetData
-        else { return false }
-
-        let keys = (asset.uploaded.otrKey!, asset.uploaded.sha256!)
-
-        if asset.original.hasRasterImage {
-            return storeAndDecryptImage(asset: asset, message: message, data: data, keys: keys)
-        } else {
-            return storeAndDecryptFile(asset: asset, message: message, data: data, keys: keys)
-        }
-    }
-
-    private func storeAndDecryptImage(asset: ZMAsset, message: ZMAssetClientMessage, data: Data, keys: DecryptionKeys) -> Bool {
-        precondition(asset.original.hasRasterImage, "Should only be called for assets with image")
-
-        let cache = managedObjectContext.zm_fileAssetCache
-        cache.storeAssetData(message, format: .medium, encrypted: true, data: data)
-        let success = cache.decryptImageIfItMatchesDigest(message, format: .medium, encryptionKey: keys.otrKey, sha256Digest: keys.sha256)
-        if !success {
-            zmLog.error("Failed to decrypt v3 asset (image) message: \(asset), nonce:\(message.nonce!)")
-        }
-        return success
     }
 
-    private func storeAndDecryptFile(asset: ZMAsset, message: ZMAssetClientMessage, data: Data, keys: DecryptionKeys) -> Bool {
-        precondition(!asset.original.hasRasterImage, "Should not be called for assets with image")
-
-        let cache = managedObjectContext.zm_fileAssetCache
-        cache.storeAssetData(message, encrypted: true, data: data)
-        let success = cache.decryptFileIfItMatchesDigest(message, encryptionKey: keys.otrKey, sha256Digest: keys.sha256)
-        if !success {
-            zmLog.error("Failed to decrypt v3 asset (file) message: \(asset), nonce:\(message.nonce!)")
+    /// Decrypts the asset off the context queue and stores the plaintext in the file cache
+    private func decryptAndStore(data: Data, for message: ZMAssetClientMessage) {
+        guard let asset = message.genericAssetMessage?.assetData,
+              let otrKey = asset.uploaded.otrKey,
+              let sha256 = asset.uploaded.sha256
+        else { return }
+
+        let format: ZMImageFormat? = asset.original.hasRasterImage ? .medium : nil
+        decryptor.decrypt(data, key: otrKey, sha256: sha256, on: managedObjectContext) { [weak self] url in
+            guard let `self` = self, !message.isZombieObject else {
+                if let url = url {
+                    try? FileManager.default.removeItem(at: url)
+                }
+                return
+            }
+            
+            if let url = url {
+                StreamingAssetDecryptor.store(plaintextAt: url, for: message, format: format, in: self.managedObjectContext.zm_fileAssetCache)
+            } else {
+                zmLog.error("Failed to decrypt v3 asset message: \(asset), nonce:\(message.nonce!)")
+            }
+            
+            // we've just downloaded some data, we need to refresh the category of the message.
+            message.updateCategoryCache()
+            self.managedObjectContext.enqueueDelayedSave()
+            
+            if url != nil {
+                NotificationDispatcher.notifyNonCoreDataChanges(objectID: message.objectID,
+                                                                changedKeys: [#keyPath(ZMAssetClientMessage.hasDownloadedFile)],
+                                                                uiContext: self.managedObjectContext.zm_userInterface!)
+            }
         }
-        return success
     }
 
     // MARK: - ZMContextChangeTrackerSource
@@ -165,14 +160,14 @@ fileprivate let zmLog = ZMSLog(tag: "Asset V3")
                 assetClientMessage.associatedTaskIdentifier = taskIdentifier
             }
 
+            let transfer = AssetTransferManager.Transfer(messageID: assetClientMessage.objectID, kind: .download)
+
             let completionHandler = ZMCompletionHandler(on: self.managedObjectContext) { response in
+                self.transferManager.end(transfer)
                 self.handleResponse(response, forMessage: assetClientMessage)
             }
 
-            let progressHandler = ZMTaskProgressHandler(on: self.managedObjectContext) { progress in
-                assetClientMessage.progress = progress
-                self.managedObjectContext.enqueueDelayedSave()
-            }
+            let progressHandler = transferManager.progressHandler(for: assetClientMessage, in: managedObjectContext)
 
             if let asset = assetClientMessage.genericAssetMessage?.assetData {
                 let token = asset.uploaded.hasAssetToken() ? asset.uploaded.assetToken : nil
@@ -180,6 +175,8 @@ fileprivate let zmLog = ZMSLog(tag: "Asset V3")
                     request.add(taskCreationHandler)
                     request.add(completionHandler)
                     request.add(progressHandler)
+                    request.priorityLevel = .lowLevel
+                    transferManager.begin(transfer, priority: .userInitiated)
                     return request
                 }
             }
@@ -150,6 +150,7 @@ class AssetV3DownloadRequestStrategyTests: MessagingTestBase {
             XCTAssertEqual(request.method, .methodGET)
             XCTAssertEqual(request.path, "/assets/v3/\(expectedAssetId)")
             XCTAssert(request.needsAuthentication)
+            XCTAssertEqual(request.priorityLevel, .lowLevel)
         }
     }
 
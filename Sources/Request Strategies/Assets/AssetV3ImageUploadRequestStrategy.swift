@@ -105,7 +105,7 @@ public final class AssetV3ImageUploadRequestStrategy: AbstractRequestStrategy, Z
     public override init(withManagedObjectContext managedObjectContext: NSManagedObjectContext, applicationStatus: ApplicationStatus) {
         preprocessor = ZMImagePreprocessingTracker(
             managedObjectContext: managedObjectContext,
-            imageProcessingQueue: OperationQueue(),
+            imageProcessingQueue: managedObjectContext.imagePreprocessingQueue,
             fetch: NSPredicate(format: "delivered == NO && version == 3"),
             needsProcessingPredicate: ZMAssetClientMessage.v3_imageProcessingFilter,
             entityClass: ZMAssetClientMessage.self
@@ -12,6 +12,7 @@ private let zmLog = ZMSLog(tag: "AssetPreviewDownloading")
 
     fileprivate var downstreamSync: ZMDownstreamObjectSyncWithWhitelist!
     private var token: Any? = nil
+    private let decryptor = StreamingAssetDecryptor()
     
     public override init(withManagedObjectContext managedObjectContext: NSManagedObjectContext, applicationStatus: ApplicationStatus?) {
         super.init(withManagedObjectContext: managedObjectContext, applicationStatus: applicationStatus)
@@ -61,26 +62,27 @@ private let zmLog = ZMSLog(tag: "AssetPreviewDownloading")
         guard let asset = assetClientMessage.genericAssetMessage?.assetData, response.result == .success else { return }
         guard let remote = asset.preview.remote, assetClientMessage.visibleInConversation != nil else { return }
 
-        let cache = managedObjectContext.zm_fileAssetCache
-        cache.storeAssetData(assetClientMessage, format: .medium, encrypted: true, data: response.rawData!)
-
         // Decrypt the preview image file
-        let success = cache.decryptImageIfItMatchesDigest(
-            assetClientMessage,
-            format: .medium,
-            encryptionKey: remote.otrKey,
-            sha256Digest: remote.sha256
-        )
+        decryptor.decrypt(response.rawData!, key: remote.otrKey, sha256: remote.sha256, on: managedObjectContext) { [weak self] url in
+            guard let `self` = self, !assetClientMessage.isZombieObject else {
+                if let url = url {
+                    try? FileManager.default.removeItem(at: url)
+                }
+                return
+            }
+            
+            if let url = url {
+                StreamingAssetDecryptor.store(plaintextAt: url, for: assetClientMessage, format: .medium, in: self.managedObjectContext.zm_fileAssetCache)
+            } else {
+                zmLog.error("Unable to decrypt preview image for file message: \(assetClientMessage), \(asset)")
+            }
 
-        if !success {
-            zmLog.error("Unable to decrypt preview image for file message: \(assetClientMessage), \(asset)")
+            // Notify about the changes
+            guard let uiMOC = self.managedObjectContext.zm_userInterface else { return }
+            NotificationDispatcher.notifyNonCoreDataChanges(objectID: assetClientMessage.objectID,
+                                                            changedKeys: [#keyPath(ZMAssetClientMessage.hasDownloadedPreview)],
+                                                            uiContext: uiMOC)
         }
-
-        // Notify about the changes
-        guard let uiMOC = managedObjectContext.zm_userInterface else { return }
-        NotificationDispatcher.notifyNonCoreDataChanges(objectID: assetClientMessage.objectID,
-                                                        changedKeys: [#keyPath(ZMAssetClientMessage.hasDownloadedPreview)],
-                                                        uiContext: uiMOC)
     }
 
     // MARK: - ZMContextChangeTrackerSource
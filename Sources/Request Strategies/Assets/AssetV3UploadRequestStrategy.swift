@@ -5,14 +5,33 @@ import Foundation
 /// AssetV3UploadRequestStrategy is responsible for uploading all the assets associated with a asset message
 /// after they've been preprocessed (downscaled & encrypted). After all the assets have been uploaded
 /// transfer state is changed to .uploaded which is the signal that the asset message is ready to be sent.
+///
+/// The first asset of a message is uploaded by the upstream sync, the others in parallel to it.
 public final class AssetV3UploadRequestStrategy: AbstractRequestStrategy, ZMContextChangeTrackerSource {
     
     internal let requestFactory = AssetRequestFactory()
     internal var upstreamSync: ZMUpstreamModifiedObjectSync!
     internal var preprocessor: AssetsPreprocessor
     
+    /// Assets of messages already being uploaded, waiting for a free slot to be uploaded in parallel
+    internal var pendingParallelUploads: [AssetTransferManager.Transfer] = []
+    
+    internal var transferManager: AssetTransferManager {
+        return managedObjectContext.assetTransferManager
+    }
+    
+    fileprivate static let assetIndexKey = "assetIndex"
+    
+    /// Removes the upload files left behind by a previous run, once per process
+    private static let removeOrphanedUploadFiles: Void = {
+        DispatchQueue.global(qos: .background).async {
+            AssetRequestFactory.removeOrphanedUploadFiles()
+        }
+    }()
+    
     public override init(withManagedObjectContext managedObjectContext: NSManagedObjectContext, applicationStatus: ApplicationStatus?) {
         preprocessor = AssetsPreprocessor(managedObjectContext: managedObjectContext)
+        _ = AssetV3UploadRequestStrategy.removeOrphanedUploadFiles
         
         super.init(withManagedObjectContext: managedObjectContext, applicationStatus: applicationStatus)
         configuration = [.allowsRequestsDuringEventProcessing,
@@ -35,14 +54,15 @@ public final class AssetV3UploadRequestStrategy: AbstractRequestStrategy, ZMCont
     }
     
     public override func nextRequestIfAllowed() -> ZMTransportRequest? {
-        return upstreamSync.nextRequest()
+        guard transferManager.canStartTransfer(priority: .background) else { return nil }
+        return nextParallelUploadRequest() ?? upstreamSync.nextRequest()
     }
     
-    private static var updatePredicate: NSPredicate {
+    fileprivate static var updatePredicate: NSPredicate {
         return NSPredicate(format: "version == 3 && delivered == NO && transferState == \(AssetTransferState.uploading.rawValue)")
     }
     
-    private static var filterPredicate: NSPredicate {
+    fileprivate static var filterPredicate: NSPredicate {
         return NSPredicate(format: "processingState == \(AssetProcessingState.uploading.rawValue)")
     }
 }
@@ -66,14 +86,36 @@ extension AssetV3UploadRequestStrategy: ZMContextChangeTracker {
     }
     
     public func fetchRequestForTrackedObjects() -> NSFetchRequest<NSFetchRequestResult>? {
-        return nil
+        return ZMAssetClientMessage.sortedFetchRequest(with: AssetV3UploadRequestStrategy.updatePredicate)
     }
     
+    /// Parallel uploads are only kept in memory, the ones of messages left by the upstream sync
+    /// are derived again from the assets which are not uploaded yet.
     public func addTrackedObjects(_ objects: Set<NSManagedObject>) {
-        // no op
+        let messages = objects.compactMap { object -> ZMAssetClientMessage? in
+            guard let message = object as? ZMAssetClientMessage,
+                  AssetV3UploadRequestStrategy.filterPredicate.evaluate(with: message),
+                  !message.keysThatHaveLocalModifications.contains(#keyPath(ZMAssetClientMessage.transferState))
+                  else { return nil }
+            return message
+        }
+        
+        for message in messages {
+            for index in indicesOfAssetsToUpload(for: message) {
+                let transfer = AssetTransferManager.Transfer(messageID: message.objectID, assetIndex: index)
+                if !pendingParallelUploads.contains(transfer) {
+                    pendingParallelUploads.append(transfer)
+                }
+            }
+        }
     }
     
     fileprivate func cancelOutstandingUploadRequests(forMessage message: ZMAssetClientMessage) {
+        pendingParallelUploads.removeAll { $0.messageID == message.objectID }
+        transferManager.removeTaskIdentifiers(forMessageWith: message.objectID).forEach {
+            applicationStatus?.requestCancellation.cancelTask(with: $0)
+        }
+        
         guard let identifier = message.associatedTaskIdentifier else { return }
         applicationStatus?.requestCancellation.cancelTask(with: identifier)
         message.associatedTaskIdentifier = nil
@@ -96,48 +138,136 @@ extension AssetV3UploadRequestStrategy: ZMUpstreamTranscoder {
         // no-op
     }
     
-    public func request(forUpdating managedObject: ZMManagedObject, forKeys keys: Set<String>) -> ZMUpstreamRequest? {
-        guard let message = managedObject as? AssetMessage else { fatal("Could not cast to ZMAssetClientMessage, it is \(type(of: managedObject)))") }
-        guard let asset = message.assets.first(where: { !$0.isUploaded} ) else { return nil } // TODO jacob are we sure we only have one upload per message active?
+    /// A message whose remaining assets are all uploaded in parallel leaves the upstream sync,
+    /// so that it doesn't hold back the messages behind it.
+    public func shouldCreateRequest(toSyncObject managedObject: ZMManagedObject, forKeys keys: Set<String>, withSync sync: Any) -> Bool {
+        guard let message = managedObject as? ZMAssetClientMessage else { return false }
+        guard indicesOfAssetsToUpload(for: message).isEmpty else { return true }
         
-        return requestForUploadingAsset(asset, for: managedObject as! ZMAssetClientMessage)
+        message.resetLocallyModifiedKeys([#keyPath(ZMAssetClientMessage.transferState)])
+        upstreamSync.objectsDidChange([message])
+        return false
     }
     
-    private func requestForUploadingAsset(_ asset: Asset, for message: ZMAssetClientMessage) -> ZMUpstreamRequest {
-        guard let data = asset.encrypted else { fatal("Encrypted data not available") }
-        guard let retention = message.conversation.map(AssetRequestFactory.Retention.init) else { fatal("Trying to send message that doesn't have a conversation") }
-        guard let request = requestFactory.backgroundUpstreamRequestForAsset(message: message, withData: data, shareable: false, retention: retention) else { fatal("Could not create asset request") }
+    public func request(forUpdating managedObject: ZMManagedObject, forKeys keys: Set<String>) -> ZMUpstreamRequest? {
+        guard let message = managedObject as? ZMAssetClientMessage else { fatal("Could not cast to ZMAssetClientMessage, it is \(type(of: managedObject)))") }
+        
+        let assetIndices = indicesOfAssetsToUpload(for: message)
+        guard let assetIndex = assetIndices.first else { return nil }
+        
+        // The other assets of the message (e.g. preview and original) are uploaded in parallel
+        for index in assetIndices.dropFirst() {
+            let transfer = AssetTransferManager.Transfer(messageID: message.objectID, assetIndex: index)
+            if !pendingParallelUploads.contains(transfer) {
+                pendingParallelUploads.append(transfer)
+            }
+        }
         
+        let transfer = AssetTransferManager.Transfer(messageID: message.objectID, assetIndex: assetIndex)
+        let request = requestForUploadingAsset(at: assetIndex, for: message)
         request.add(ZMTaskCreatedHandler(on: managedObjectContext) { identifier in
             message.associatedTaskIdentifier = identifier
         })
-        request.add(ZMTaskProgressHandler(on: self.managedObjectContext) { progress in
-            message.progress = progress
-            self.managedObjectContext.enqueueDelayedSave()
+        request.add(ZMCompletionHandler(on: managedObjectContext) { [weak self] _ in
+            self?.transferManager.end(transfer)
         })
+        transferManager.begin(transfer, priority: .background)
         
-        return ZMUpstreamRequest(keys: [#keyPath(ZMAssetClientMessage.transferState)], transportRequest: request)
+        return ZMUpstreamRequest(keys: [#keyPath(ZMAssetClientMessage.transferState)],
+                                 transportRequest: request,
+                                 userInfo: [AssetV3UploadRequestStrategy.assetIndexKey: assetIndex])
     }
     
-    public func updateUpdatedObject(_ managedObject: ZMManagedObject, requestUserInfo: [AnyHashable : Any]? = nil, response: ZMTransportResponse, keysToParse: Set<String>) -> Bool {
+    /// Indices of the assets of the message which are neither uploaded, being uploaded nor waiting to be uploaded in parallel
+    private func indicesOfAssetsToUpload(for message: ZMAssetClientMessage) -> [Int] {
+        return message.assets.enumerated().compactMap { index, asset in
+            let transfer = AssetTransferManager.Transfer(messageID: message.objectID, assetIndex: index)
+            guard !asset.isUploaded, !transferManager.isRunning(transfer), !pendingParallelUploads.contains(transfer) else { return nil }
+            return index
+        }
+    }
+    
+    /// Assets are uploaded from a file by the background session, whatever their size
+    private func requestForUploadingAsset(at index: Int, for message: ZMAssetClientMessage) -> ZMTransportRequest {
+        guard let data = message.assets[index].encrypted else { fatal("Encrypted data not available") }
+        guard let retention = message.conversation.map(AssetRequestFactory.Retention.init) else { fatal("Trying to send message that doesn't have a conversation") }
+        guard let request = requestFactory.backgroundUpstreamRequestForAsset(message: message, withData: data, assetIndex: index, shareable: false, retention: retention) else { fatal("Could not create asset request") }
         
-        guard response.result == .success else { return false }
-        guard let message = managedObject as? ZMAssetClientMessage else { return false }
-        guard let asset = message.assets.first(where: { !$0.isUploaded}) else {return false }
+        request.add(transferManager.progressHandler(for: message, in: managedObjectContext))
+        
+        return request
+    }
+    
+    /// Stores the key of the uploaded asset from the response
+    private func didUpload(assetAt index: Int, of message: ZMAssetClientMessage, response: ZMTransportResponse) {
         guard let payload = response.payload?.asDictionary(),
               let assetId = payload["key"] as? String else {
             fatal("No asset ID present in payload")
         }
+        message.assets[index].updateWithAssetId(assetId, token: payload["token"] as? String)
+    }
+    
+    /// Creates a request for the next asset waiting to be uploaded in parallel, outside of the upstream sync
+    private func nextParallelUploadRequest() -> ZMTransportRequest? {
+        while !pendingParallelUploads.isEmpty {
+            let transfer = pendingParallelUploads.removeFirst()
+            guard
+                let message = (try? managedObjectContext.existingObject(with: transfer.messageID)) as? ZMAssetClientMessage,
+                !message.isZombieObject,
+                message.transferState == .uploading,
+                transfer.assetIndex < message.assets.count,
+                !message.assets[transfer.assetIndex].isUploaded,
+                !transferManager.isRunning(transfer) else { continue }
+            
+            let request = requestForUploadingAsset(at: transfer.assetIndex, for: message)
+            request.add(ZMTaskCreatedHandler(on: managedObjectContext) { [weak self] identifier in
+                self?.transferManager.setTaskIdentifier(identifier, for: transfer)
+            })
+            request.add(ZMCompletionHandler(on: managedObjectContext) { [weak self] response in
+                self?.handleParallelUploadResponse(response, for: transfer, message: message)
+            })
+            transferManager.begin(transfer, priority: .background)
+            return request
+        }
+        return nil
+    }
+    
+    private func handleParallelUploadResponse(_ response: ZMTransportResponse, for transfer: AssetTransferManager.Transfer, message: ZMAssetClientMessage) {
+        transferManager.end(transfer)
+        guard !message.isZombieObject, message.transferState == .uploading else { return }
         
-        let token = payload["token"] as? String
+        switch response.result {
+        case .success:
+            didUpload(assetAt: transfer.assetIndex, of: message, response: response)
+            updateTransferStateIfAllAssetsAreUploaded(message)
+        case .permanentError, .expired:
+            message.expire()
+        default:
+            // Try again once a slot is free
+            pendingParallelUploads.append(transfer)
+            RequestAvailableNotification.notifyNewRequestsAvailable(self)
+        }
+        managedObjectContext.enqueueDelayedSave()
+    }
+    
+    private func updateTransferStateIfAllAssetsAreUploaded(_ message: ZMAssetClientMessage) {
+        guard message.processingState == .done else { return }
+        message.updateTransferState(.uploaded, synchronize: true)
+    }
+    
+    public func updateUpdatedObject(_ managedObject: ZMManagedObject, requestUserInfo: [AnyHashable : Any]? = nil, response: ZMTransportResponse, keysToParse: Set<String>) -> Bool {
         
-        asset.updateWithAssetId(assetId, token: token)
+        guard response.result == .success else { return false }
+        guard let message = managedObject as? ZMAssetClientMessage else { return false }
+        guard let assetIndex = requestUserInfo?[AssetV3UploadRequestStrategy.assetIndexKey] as? Int,
+              assetIndex < message.assets.count else { return false }
         
-        if message.processingState == .done {
-            message.updateTransferState(.uploaded, synchronize: true)
-        }
+        didUpload(assetAt: assetIndex, of: message, response: response)
+        updateTransferStateIfAllAssetsAreUploaded(message)
         
-        return true // We always need to make one more request to send OTR message in the conversation
+        // We need to make one more request to send OTR message in the conversation,
+        // unless the assets left are uploaded in parallel, which then complete the message
+        return message.transferState != .uploading || !indicesOfAssetsToUpload(for: message).isEmpty
     }
     
     public func shouldRetryToSyncAfterFailed(toUpdate managedObject: ZMManagedObject,
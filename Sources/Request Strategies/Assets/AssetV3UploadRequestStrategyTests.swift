@@ -63,6 +63,19 @@ class AssetV3UploadRequestStrategyTests: MessagingTestBase {
         return message
     }
     
+    @discardableResult func createLargeFileMessage(size: Int = 3 * 1024 * 1024) -> ZMAssetClientMessage {
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).bin")
+        try! Data.secureRandomData(length: size).write(to: url)
+        defer { try? FileManager.default.removeItem(at: url) }
+        
+        let message = groupConversation.append(file: ZMFileMetadata(fileURL: url)) as! ZMAssetClientMessage
+        message.updateTransferState(.uploading, synchronize: true)
+        message.assets.forEach { $0.encrypt() }
+        syncMOC.saveOrRollback()
+        
+        return message
+    }
+    
     // MARK: - Request generation
     
     func testThatItGeneratesRequestWhenAssetIsPreprocessed() {
@@ -141,6 +154,147 @@ class AssetV3UploadRequestStrategyTests: MessagingTestBase {
         }
     }
     
+    func testThatItGeneratesRequestsForAllAssetsOfAMessageInParallel() {
+        syncMOC.performGroupedBlockAndWait {
+            // given
+            let message = self.createFileMessage() // has two assets (file and thumbnail)
+            self.sut.upstreamSync?.objectsDidChange(Set(arrayLiteral: message))
+            self.syncMOC.assetTransferManager.maxConcurrentTransfers = 3
+            
+            // when
+            let firstRequest = self.sut.nextRequest()
+            let secondRequest = self.sut.nextRequest()
+            
+            // then
+            XCTAssertNotNil(firstRequest)
+            XCTAssertNotNil(secondRequest)
+            XCTAssertEqual(self.syncMOC.assetTransferManager.runningTransfersCount, 2)
+            XCTAssertNil(self.sut.nextRequest())
+        }
+    }
+    
+    func testThatItDoesNotGenerateRequestsWhenAllBackgroundSlotsAreUsed() {
+        syncMOC.performGroupedBlockAndWait {
+            // given
+            let message = self.createFileMessage()
+            self.sut.upstreamSync?.objectsDidChange(Set(arrayLiteral: message))
+            self.syncMOC.assetTransferManager.maxConcurrentTransfers = 2
+            
+            // when
+            let firstRequest = self.sut.nextRequest()
+            let secondRequest = self.sut.nextRequest()
+            
+            // then - one slot is kept for user initiated transfers
+            XCTAssertNotNil(firstRequest)
+            XCTAssertNil(secondRequest)
+        }
+    }
+    
+    func testThatItMarksMessageAsUploaded_WhenAllParallelUploadsSucceed() {
+        var message: ZMAssetClientMessage!
+        syncMOC.performGroupedBlockAndWait {
+            // given
+            message = self.createFileMessage()
+            self.sut.upstreamSync?.objectsDidChange(Set(arrayLiteral: message))
+            self.syncMOC.assetTransferManager.maxConcurrentTransfers = 3
+            let firstRequest = self.sut.nextRequest()
+            let secondRequest = self.sut.nextRequest()
+            
+            // when
+            secondRequest?.complete(with: ZMTransportResponse(payload: ["key": "asset-id-2"] as ZMTransportData, httpStatus: 201, transportSessionError: nil))
+            firstRequest?.complete(with: ZMTransportResponse(payload: ["key": "asset-id-1"] as ZMTransportData, httpStatus: 201, transportSessionError: nil))
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            // then
+            XCTAssertEqual(message.transferState, .uploaded)
+            XCTAssertEqual(self.syncMOC.assetTransferManager.runningTransfersCount, 0)
+        }
+    }
+    
+    func testThatAMessageUploadingItsLastAssetsInParallel_DoesNotHoldBackTheNextMessage() {
+        syncMOC.performGroupedBlockAndWait {
+            // given - the first asset of a message is uploaded, its second one waits to be uploaded in parallel
+            let message = self.createFileMessage() // has two assets (file and thumbnail)
+            self.sut.upstreamSync?.objectsDidChange(Set(arrayLiteral: message))
+            self.syncMOC.assetTransferManager.maxConcurrentTransfers = 4
+            let firstRequest = self.sut.nextRequest()
+            firstRequest?.complete(with: ZMTransportResponse(payload: ["key": "asset-id-1"] as ZMTransportData, httpStatus: 201, transportSessionError: nil))
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            let nextMessage = self.createImageMessage()
+            self.sut.upstreamSync?.objectsDidChange(Set(arrayLiteral: nextMessage))
+            
+            // when
+            let parallelRequest = self.sut.nextRequest()
+            let nextMessageRequest = self.sut.nextRequest()
+            
+            // then
+            XCTAssertNotNil(parallelRequest)
+            XCTAssertNotNil(nextMessageRequest)
+            XCTAssertEqual(self.syncMOC.assetTransferManager.runningTransfersCount, 2)
+        }
+    }
+    
+    func testThatItDoesNotSyncAMessage_WhenAllItsAssetsLeftAreUploadedInParallel() {
+        syncMOC.performGroupedBlockAndWait {
+            // given
+            let message = self.createFileMessage()
+            self.sut.pendingParallelUploads = message.assets.indices.map { AssetTransferManager.Transfer(messageID: message.objectID, assetIndex: $0) }
+            
+            // when
+            let shouldCreateRequest = self.sut.shouldCreateRequest(toSyncObject: message,
+                                                                   forKeys: [#keyPath(ZMAssetClientMessage.transferState)],
+                                                                   withSync: self.sut.upstreamSync!)
+            
+            // then
+            XCTAssertFalse(shouldCreateRequest)
+            XCTAssertFalse(message.keysThatHaveLocalModifications.contains(#keyPath(ZMAssetClientMessage.transferState)))
+        }
+    }
+    
+    func testThatItUploadsTheAssetsOfAMessageLeftByTheUpstreamSync_AfterARelaunch() {
+        syncMOC.performGroupedBlockAndWait {
+            // given - the message left the upstream sync while its assets were uploaded in parallel
+            let message = self.createFileMessage()
+            message.resetLocallyModifiedKeys([#keyPath(ZMAssetClientMessage.transferState)])
+            self.syncMOC.assetTransferManager.maxConcurrentTransfers = 4
+            
+            // when
+            self.sut.addTrackedObjects(Set(arrayLiteral: message))
+            
+            // then
+            XCTAssertEqual(self.sut.pendingParallelUploads.count, 2)
+            XCTAssertNotNil(self.sut.nextRequest())
+            XCTAssertNotNil(self.sut.nextRequest())
+        }
+    }
+    
+    func testThatItUploadsALargeAssetInOneRequest() {
+        // given
+        var message: ZMAssetClientMessage!
+        syncMOC.performGroupedBlockAndWait {
+            message = self.createLargeFileMessage()
+            self.sut.upstreamSync?.objectsDidChange(Set(arrayLiteral: message))
+            
+            // when
+            guard let request = self.sut.nextRequest() else { return XCTFail("No request generated") }
+            
+            // then
+            XCTAssertEqual(request.path, "/assets/v3")
+            XCTAssertEqual(request.method, .methodPOST)
+            request.complete(with: ZMTransportResponse(payload: ["key": "asset-id-1"] as ZMTransportData, httpStatus: 201, transportSessionError: nil))
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            XCTAssertEqual(message.genericMessage?.assetData?.uploaded?.assetId, "asset-id-1")
+        }
+    }
+    
     // MARK: - Request cancellation
     
     func testThatItCancelsRequest_WhenTransferStateChangesToUploadingCancelled() {
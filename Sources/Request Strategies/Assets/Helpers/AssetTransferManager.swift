@@ -0,0 +1,166 @@
+//
+
+import Foundation
+import WireDataModel
+
+private let AssetTransferManagerKey = "AssetTransferManagerKey"
+
+/// Keeps track of the asset uploads and downloads running on a context.
+///
+/// It bounds the number of transfers running at the same time so that large assets don't
+/// compete with message traffic, keeps one slot free for transfers the user is waiting for,
+/// and limits how often the progress of the transfers triggers a save of the context.
+/// The last progress update of a burst is always saved, after the interval has passed.
+///
+/// The manager must only be used from the queue of the context it belongs to.
+public final class AssetTransferManager: NSObject {
+
+    public enum Priority {
+        /// e.g. uploads of assets that were sent in the background
+        case background
+        /// e.g. downloads the user just requested
+        case userInitiated
+    }
+
+    /// Identifies the transfer of one asset of a message
+    public struct Transfer: Hashable {
+
+        public enum Kind {
+            case upload
+            case download
+        }
+
+        public let messageID: NSManagedObjectID
+        public let assetIndex: Int
+        public let kind: Kind
+
+        public init(messageID: NSManagedObjectID, assetIndex: Int = 0, kind: Kind = .upload) {
+            self.messageID = messageID
+            self.assetIndex = assetIndex
+            self.kind = kind
+        }
+    }
+
+    /// Maximum number of transfers running at the same time
+    public var maxConcurrentTransfers: Int
+
+    /// Number of slots only available to `.userInitiated` transfers
+    public var reservedUserInitiatedSlots: Int = 1
+
+    /// Minimum interval between two saves caused by progress updates
+    public var progressSaveInterval: TimeInterval
+
+    private(set) var runningTransfers: [Transfer: Priority] = [:]
+    private var taskIdentifiers: [Transfer: ZMTaskIdentifier] = [:]
+    private var lastProgressSave: Date?
+    private var hasScheduledProgressSave = false
+    private let currentDate: () -> Date
+    private let schedule: (TimeInterval, @escaping () -> Void) -> Void
+
+    /// - parameter currentDate: returns the current date, used to throttle the progress saves
+    /// - parameter schedule: runs a block after a delay, used for the trailing progress save
+    public init(maxConcurrentTransfers: Int = 3,
+                progressSaveInterval: TimeInterval = 0.5,
+                currentDate: @escaping () -> Date = Date.init,
+                schedule: @escaping (TimeInterval, @escaping () -> Void) -> Void = { delay, block in
+                    DispatchQueue.global().asyncAfter(deadline: .now() + delay, execute: block)
+                }) {
+        self.maxConcurrentTransfers = maxConcurrentTransfers
+        self.progressSaveInterval = progressSaveInterval
+        self.currentDate = currentDate
+        self.schedule = schedule
+        super.init()
+    }
+
+    // MARK: - Slots
+
+    public var runningTransfersCount: Int {
+        return runningTransfers.count
+    }
+
+    /// Whether a new transfer with the given priority can start now
+    public func canStartTransfer(priority: Priority) -> Bool {
+        switch priority {
+        case .userInitiated:
+            return runningTransfers.count < maxConcurrentTransfers
+        case .background:
+            let backgroundSlots = max(1, maxConcurrentTransfers - reservedUserInitiatedSlots)
+            return runningTransfers.count < backgroundSlots
+        }
+    }
+
+    public func isRunning(_ transfer: Transfer) -> Bool {
+        return runningTransfers[transfer] != nil
+    }
+
+    public func begin(_ transfer: Transfer, priority: Priority) {
+        runningTransfers[transfer] = priority
+    }
+
+    public func end(_ transfer: Transfer) {
+        runningTransfers.removeValue(forKey: transfer)
+        taskIdentifiers.removeValue(forKey: transfer)
+    }
+
+    // MARK: - Tasks
+
+    public func setTaskIdentifier(_ identifier: ZMTaskIdentifier, for transfer: Transfer) {
+        taskIdentifiers[transfer] = identifier
+    }
+
+    /// Returns and forgets the task identifiers of all the running transfers of a message of the given kind
+    public func removeTaskIdentifiers(forMessageWith messageID: NSManagedObjectID, kind: Transfer.Kind = .upload) -> [ZMTaskIdentifier] {
+        let transfers = taskIdentifiers.keys.filter { $0.messageID == messageID && $0.kind == kind }
+        return transfers.compactMap { taskIdentifiers.removeValue(forKey: $0) }
+    }
+
+    // MARK: - Progress
+
+    /// Saves the context after a progress update, at most once every `progressSaveInterval`.
+    /// An update arriving within the interval is saved once the interval has passed.
+    public func progressDidChange(in managedObjectContext: NSManagedObjectContext) {
+        let now = currentDate()
+        if let lastSave = lastProgressSave, now.timeIntervalSince(lastSave) < progressSaveInterval {
+            scheduleProgressSave(after: progressSaveInterval - now.timeIntervalSince(lastSave), in: managedObjectContext)
+            return
+        }
+        lastProgressSave = now
+        managedObjectContext.enqueueDelayedSave()
+    }
+
+    private func scheduleProgressSave(after delay: TimeInterval, in managedObjectContext: NSManagedObjectContext) {
+        guard !hasScheduledProgressSave else { return }
+        hasScheduledProgressSave = true
+
+        schedule(delay) { [weak self, weak managedObjectContext] in
+            managedObjectContext?.performGroupedBlock {
+                guard let `self` = self, let managedObjectContext = managedObjectContext else { return }
+                self.hasScheduledProgressSave = false
+                self.lastProgressSave = self.currentDate()
+                managedObjectContext.enqueueDelayedSave()
+            }
+        }
+    }
+
+    /// Creates a progress handler which updates the progress of the message
+    /// and saves it through `progressDidChange(in:)`
+    public func progressHandler(for message: ZMAssetClientMessage, in managedObjectContext: NSManagedObjectContext) -> ZMTaskProgressHandler {
+        return ZMTaskProgressHandler(on: managedObjectContext) { [weak self] progress in
+            message.progress = progress
+            self?.progressDidChange(in: managedObjectContext)
+        }
+    }
+}
+
+extension NSManagedObjectContext {
+
+    /// The transfer manager shared by the asset strategies running on this context
+    public var assetTransferManager: AssetTransferManager {
+        if let manager = userInfo[AssetTransferManagerKey] as? AssetTransferManager {
+            return manager
+        }
+        let manager = AssetTransferManager()
+        userInfo[AssetTransferManagerKey] = manager
+        return manager
+    }
+}
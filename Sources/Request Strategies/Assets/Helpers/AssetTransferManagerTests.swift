@@ -0,0 +1,192 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class AssetTransferManagerTests: MessagingTestBase {
+    
+    var sut: AssetTransferManager!
+    var now: Date!
+    var scheduledBlocks: [(delay: TimeInterval, block: () -> Void)]!
+    
+    override func setUp() {
+        super.setUp()
+        now = Date()
+        scheduledBlocks = []
+        sut = AssetTransferManager(maxConcurrentTransfers: 2,
+                                   progressSaveInterval: 1,
+                                   currentDate: { [unowned self] in self.now },
+                                   schedule: { [unowned self] delay, block in self.scheduledBlocks.append((delay, block)) })
+    }
+    
+    override func tearDown() {
+        sut = nil
+        now = nil
+        scheduledBlocks = nil
+        super.tearDown()
+    }
+    
+    func transfer(assetIndex: Int = 0) -> AssetTransferManager.Transfer {
+        var message: ZMMessage!
+        syncMOC.performGroupedBlockAndWait {
+            message = self.groupConversation.append(text: "Lorem") as? ZMMessage
+            self.syncMOC.saveOrRollback()
+        }
+        return AssetTransferManager.Transfer(messageID: message.objectID, assetIndex: assetIndex)
+    }
+    
+    // MARK: - Slots
+    
+    func testThatItKeepsASlotForUserInitiatedTransfers() {
+        // given
+        sut.begin(transfer(), priority: .background)
+        
+        // then
+        XCTAssertFalse(sut.canStartTransfer(priority: .background))
+        XCTAssertTrue(sut.canStartTransfer(priority: .userInitiated))
+    }
+    
+    func testThatItDoesNotStartTransfersAboveTheLimit() {
+        // given
+        sut.begin(transfer(), priority: .userInitiated)
+        sut.begin(transfer(), priority: .userInitiated)
+        
+        // then
+        XCTAssertFalse(sut.canStartTransfer(priority: .userInitiated))
+        XCTAssertFalse(sut.canStartTransfer(priority: .background))
+    }
+    
+    func testThatItFreesTheSlotWhenATransferEnds() {
+        // given
+        let finishedTransfer = transfer()
+        sut.begin(finishedTransfer, priority: .userInitiated)
+        sut.begin(transfer(), priority: .userInitiated)
+        
+        // when
+        sut.end(finishedTransfer)
+        
+        // then
+        XCTAssertEqual(sut.runningTransfersCount, 1)
+        XCTAssertTrue(sut.canStartTransfer(priority: .userInitiated))
+        XCTAssertFalse(sut.isRunning(finishedTransfer))
+    }
+    
+    func testThatItAlwaysAllowsOneBackgroundTransfer() {
+        // given
+        sut.maxConcurrentTransfers = 1
+        
+        // then
+        XCTAssertTrue(sut.canStartTransfer(priority: .background))
+    }
+    
+    // MARK: - Tasks
+    
+    func testThatItReturnsTheTaskIdentifiersOfAMessage() {
+        // given
+        let first = transfer(assetIndex: 0)
+        let second = AssetTransferManager.Transfer(messageID: first.messageID, assetIndex: 1)
+        let other = transfer()
+        sut.setTaskIdentifier(ZMTaskIdentifier(identifier: 1, sessionIdentifier: "a"), for: first)
+        sut.setTaskIdentifier(ZMTaskIdentifier(identifier: 2, sessionIdentifier: "a"), for: second)
+        sut.setTaskIdentifier(ZMTaskIdentifier(identifier: 3, sessionIdentifier: "a"), for: other)
+        
+        // when
+        let identifiers = sut.removeTaskIdentifiers(forMessageWith: first.messageID)
+        
+        // then
+        XCTAssertEqual(Set(identifiers.map { $0.identifier }), [1, 2])
+        XCTAssertTrue(sut.removeTaskIdentifiers(forMessageWith: first.messageID).isEmpty)
+    }
+    
+    func testThatItKeepsTheDownloadOfAnAssetApartFromItsUpload() {
+        // given
+        let upload = transfer()
+        let download = AssetTransferManager.Transfer(messageID: upload.messageID, kind: .download)
+        sut.begin(upload, priority: .background)
+        sut.setTaskIdentifier(ZMTaskIdentifier(identifier: 1, sessionIdentifier: "a"), for: upload)
+        sut.setTaskIdentifier(ZMTaskIdentifier(identifier: 2, sessionIdentifier: "a"), for: download)
+        
+        // when
+        sut.end(download)
+        
+        // then
+        XCTAssertNotEqual(upload, download)
+        XCTAssertTrue(sut.isRunning(upload))
+        XCTAssertEqual(sut.removeTaskIdentifiers(forMessageWith: upload.messageID).map { $0.identifier }, [1])
+        XCTAssertEqual(sut.removeTaskIdentifiers(forMessageWith: upload.messageID, kind: .download).map { $0.identifier }, [2])
+    }
+    
+    // MARK: - Progress
+    
+    func testThatItThrottlesProgressSaves() {
+        syncMOC.performGroupedBlockAndWait {
+            // given
+            self.groupConversation.append(text: "Lorem")
+            XCTAssertTrue(self.syncMOC.hasChanges)
+            
+            // when
+            self.sut.progressDidChange(in: self.syncMOC)
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            XCTAssertFalse(self.syncMOC.hasChanges)
+            
+            // when - a second update within the interval
+            self.groupConversation.append(text: "Ipsum")
+            self.now = self.now.addingTimeInterval(0.5)
+            self.sut.progressDidChange(in: self.syncMOC)
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            // then - it's not saved
+            XCTAssertTrue(self.syncMOC.hasChanges)
+            
+            // when - an update after the interval
+            self.now = self.now.addingTimeInterval(0.6)
+            self.sut.progressDidChange(in: self.syncMOC)
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            // then
+            XCTAssertFalse(self.syncMOC.hasChanges)
+        }
+    }
+    
+    func testThatItSavesTheLastProgressUpdateOnceTheIntervalHasPassed() {
+        syncMOC.performGroupedBlockAndWait {
+            // given
+            self.sut.progressDidChange(in: self.syncMOC)
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            // when - the last updates of a burst arrive within the interval
+            self.groupConversation.append(text: "Lorem")
+            self.now = self.now.addingTimeInterval(0.25)
+            self.sut.progressDidChange(in: self.syncMOC)
+            self.now = self.now.addingTimeInterval(0.25)
+            self.sut.progressDidChange(in: self.syncMOC)
+        }
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            // then - one save is scheduled for the end of the interval
+            XCTAssertTrue(self.syncMOC.hasChanges)
+            XCTAssertEqual(self.scheduledBlocks.count, 1)
+            XCTAssertEqual(self.scheduledBlocks.first?.delay ?? 0, 0.75, accuracy: 0.001)
+        }
+        
+        // when - the interval has passed
+        now = now.addingTimeInterval(0.5)
+        scheduledBlocks.first?.block()
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        syncMOC.performGroupedBlockAndWait {
+            // then
+            XCTAssertFalse(self.syncMOC.hasChanges)
+        }
+    }
+}
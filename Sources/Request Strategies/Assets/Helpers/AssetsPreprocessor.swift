@@ -16,9 +16,17 @@ import Foundation
     
     /// List of objects currently being processed
     fileprivate var objectsBeingProcessed = Set<ZMAssetClientMessage>()
-    fileprivate let imageProcessingQueue: OperationQueue
+    fileprivate let scheduler: ImagePreprocessingScheduler
     fileprivate var imageAssetPreprocessor: ZMAssetsPreprocessor?
     
+    /// Last operation of the preprocessing currently running for a cache key,
+    /// other assets with the same key wait for it and reuse its result
+    fileprivate var preprocessingInProgress: [String: Operation] = [:]
+    
+    fileprivate var cache: PreprocessedAssetCache {
+        return managedObjectContext.preprocessedAssetCache
+    }
+    
     /// Managed object context. Is is assumed that all methods of this class
     /// are called from the thread of this managed object context
     let managedObjectContext : NSManagedObjectContext
@@ -28,7 +36,7 @@ import Foundation
     public init(managedObjectContext: NSManagedObjectContext) {
         self.processingGroup = ZMSDispatchGroup(label: "Asset Preprocessing")
         self.managedObjectContext = managedObjectContext
-        self.imageProcessingQueue = ZMImagePreprocessor.createSuitableImagePreprocessingQueue()
+        self.scheduler = ImagePreprocessingScheduler(operationQueue: managedObjectContext.imagePreprocessingQueue)
         
         super.init()
         
@@ -37,7 +45,8 @@ import Foundation
     }
     
     public func objectsDidChange(_ object: Set<NSManagedObject>) {
-        processObjects(object)
+        cancelProcessingOfDiscardedMessages(object)
+        processObjects(object, priority: .userInitiated)
     }
     
     public func fetchRequestForTrackedObjects() -> NSFetchRequest<NSFetchRequestResult>? {
@@ -46,28 +55,35 @@ import Foundation
     }
     
     public func addTrackedObjects(_ objects: Set<NSManagedObject>) {
-        processObjects(objects)
+        processObjects(objects, priority: .backlog)
     }
     
-    private func processObjects(_ objects: Set<NSManagedObject>) {
+    private func processObjects(_ objects: Set<NSManagedObject>, priority: ImagePreprocessingPriority) {
         objects
             .compactMap(needsPreprocessing)
             .filter(!objectsBeingProcessed.contains)
-            .forEach(startProcessing)
+            .forEach { startProcessing($0, priority: priority) }
+    }
+    
+    /// Cancels the image operations of messages which were deleted or cancelled while being processed
+    private func cancelProcessingOfDiscardedMessages(_ objects: Set<NSManagedObject>) {
+        objects
+            .compactMap { $0 as? ZMAssetClientMessage }
+            .filter { objectsBeingProcessed.contains($0) && ($0.isDeleted || $0.transferState == .uploadingCancelled) }
+            .forEach { scheduler.cancelOperations(for: $0) }
     }
     
     /// Starts processing the asset client message
-    fileprivate func startProcessing(_ message: ZMAssetClientMessage) {
+    fileprivate func startProcessing(_ message: ZMAssetClientMessage, priority: ImagePreprocessingPriority) {
         objectsBeingProcessed.insert(message)
         
         _ = managedObjectContext.enterAllGroups()
         
         for asset in message.assets {
             
-            if asset.needsPreprocessing,
-                let imageOperations = imageAssetPreprocessor?.operations(forPreprocessingImageOwner: AssetImageOwnerAdapter(asset: asset)) {
+            if asset.needsPreprocessing {
                 processingGroup.enter()
-                imageProcessingQueue.addOperations(imageOperations, waitUntilFinished: false)
+                computeCacheKey(of: asset, message: message, priority: priority)
             } else {
                 asset.encrypt()
             }
@@ -76,6 +92,83 @@ import Foundation
         notifyWhenProcessingIsComplete(message)
     }
     
+    /// Hashes the original image on the preprocessing queue, then reuses a cached result for the asset
+    /// or preprocesses it. The processing group must be entered for the asset.
+    fileprivate func computeCacheKey(of asset: Asset, message: ZMAssetClientMessage, priority: ImagePreprocessingPriority) {
+        let original = asset.original
+        let formats = AssetImageOwnerAdapter.requiredImageFormats(for: asset)
+        var cacheKey: String?
+        
+        let keyOperation = BlockOperation {
+            cacheKey = original.map { PreprocessedAssetCache.key(forOriginal: $0, formats: formats) }
+        }
+        keyOperation.completionBlock = { [weak self, unowned keyOperation] in
+            // The operation doesn't run if the message was discarded in the meantime
+            guard !keyOperation.isCancelled else {
+                self?.processingGroup.leave()
+                return
+            }
+            let key = cacheKey
+            self?.managedObjectContext.performGroupedBlock {
+                self?.preprocess(AssetImageOwnerAdapter(asset: asset, message: message, priority: priority, cacheKey: key))
+            }
+        }
+        scheduler.schedule([keyOperation], for: message, priority: priority)
+    }
+    
+    /// Reuses the cached result of the same preprocessing, waits for the one in progress, or preprocesses the asset.
+    /// The processing group must be entered for the asset.
+    fileprivate func preprocess(_ imageOwner: AssetImageOwnerAdapter) {
+        if let cacheKey = imageOwner.cacheKey, let entry = cache.entry(forKey: cacheKey) {
+            imageOwner.asset.updateWithPreprocessedData(entry.data, imageProperties: entry.properties)
+            imageOwner.asset.encrypt()
+            processingGroup.leave()
+        } else if let cacheKey = imageOwner.cacheKey, let running = preprocessingInProgress[cacheKey] {
+            waitForPreprocessing(running, of: imageOwner)
+        } else {
+            startPreprocessing(imageOwner)
+        }
+    }
+    
+    /// Schedules the image operations for the asset. The processing group must be entered for the asset.
+    fileprivate func startPreprocessing(_ imageOwner: AssetImageOwnerAdapter) {
+        guard let imageOperations = imageAssetPreprocessor?.operations(forPreprocessingImageOwner: imageOwner) else {
+            imageOwner.asset.encrypt()
+            processingGroup.leave()
+            return
+        }
+        
+        if let cacheKey = imageOwner.cacheKey, let lastOperation = imageOperations.last {
+            preprocessingInProgress[cacheKey] = lastOperation
+        }
+        scheduler.schedule(imageOperations, for: imageOwner.message, priority: imageOwner.priority)
+    }
+    
+    /// Reuses the result of an identical preprocessing once it has completed,
+    /// or preprocesses the asset if the result didn't make it into the cache.
+    fileprivate func waitForPreprocessing(_ operation: Operation, of imageOwner: AssetImageOwnerAdapter) {
+        let waitOperation = BlockOperation { [weak self] in
+            self?.managedObjectContext.performGroupedBlock {
+                guard let `self` = self else { return }
+                if let cacheKey = imageOwner.cacheKey, let entry = self.cache.entry(forKey: cacheKey) {
+                    imageOwner.asset.updateWithPreprocessedData(entry.data, imageProperties: entry.properties)
+                    imageOwner.asset.encrypt()
+                    self.processingGroup.leave()
+                } else {
+                    self.startPreprocessing(imageOwner)
+                }
+            }
+        }
+        waitOperation.completionBlock = { [weak self, unowned waitOperation] in
+            // The block doesn't run if the message was discarded in the meantime
+            if waitOperation.isCancelled {
+                self?.processingGroup.leave()
+            }
+        }
+        waitOperation.addDependency(operation)
+        scheduler.schedule([waitOperation], for: imageOwner.message, priority: imageOwner.priority)
+    }
+    
     /// Removes the message from the list of messages being processed when the processing is completed
     fileprivate func notifyWhenProcessingIsComplete(_ message: ZMAssetClientMessage) {
         processingGroup.notify(on: .global()) { [weak self] in
@@ -104,6 +197,10 @@ extension AssetsPreprocessor: ZMAssetsPreprocessorDelegate {
         managedObjectContext.performGroupedBlock {
             assetImageOwnerAdapter.asset.updateWithPreprocessedData(operation.downsampleImageData, imageProperties: operation.properties)
             assetImageOwnerAdapter.asset.encrypt()
+            
+            if let cacheKey = assetImageOwnerAdapter.cacheKey {
+                self.cache.store(operation.downsampleImageData, properties: operation.properties, forKey: cacheKey)
+            }
         }
     }
     
@@ -116,9 +213,17 @@ extension AssetsPreprocessor: ZMAssetsPreprocessorDelegate {
     }
     
     public func preprocessingCompleteOperation(for imageOwner: ZMImageOwner) -> Operation? {
-        return BlockOperation { [weak self] in
+        let completeOperation = BlockOperation()
+        // Runs even if the operations were cancelled because the message was discarded
+        completeOperation.completionBlock = { [weak self] in
+            if let cacheKey = (imageOwner as? AssetImageOwnerAdapter)?.cacheKey {
+                self?.managedObjectContext.performGroupedBlock {
+                    self?.preprocessingInProgress.removeValue(forKey: cacheKey)
+                }
+            }
             self?.processingGroup.leave()
         }
+        return completeOperation
     }
     
 }
@@ -127,16 +232,30 @@ extension AssetsPreprocessor: ZMAssetsPreprocessorDelegate {
 class AssetImageOwnerAdapter: NSObject, ZMImageOwner {
     
     let asset: Asset
+    /// Message of the asset, the image operations are scheduled for it
+    let message: ZMAssetClientMessage
+    let priority: ImagePreprocessingPriority
+    
+    /// Key of the preprocessed result in the `PreprocessedAssetCache`, computed before the
+    /// adapter is created so that it can be read from the threads of the image operations
+    let cacheKey: String?
     
-    init(asset: Asset) {
+    init(asset: Asset, message: ZMAssetClientMessage, priority: ImagePreprocessingPriority, cacheKey: String?) {
         self.asset = asset
+        self.message = message
+        self.priority = priority
+        self.cacheKey = cacheKey
         
         super.init()
     }
     
     func requiredImageFormats() -> NSOrderedSet {
+        return AssetImageOwnerAdapter.requiredImageFormats(for: asset)
+    }
+    
+    static func requiredImageFormats(for asset: Asset) -> NSOrderedSet {
         //return NSOrderedSet(array: [ZMImageFormat.medium.rawValue])
-        if self.asset.needsUploadOriginal {
+        if asset.needsUploadOriginal {
             return NSOrderedSet(array: [ZMImageFormat.original.rawValue])
         } else {
             return NSOrderedSet(array: [ZMImageFormat.medium.rawValue])
@@ -69,4 +69,71 @@ class AssetsPreprocessorTests: MessagingTestBase {
         XCTAssertTrue(message.modifiedKeys!.contains(#keyPath(ZMAssetClientMessage.transferState)))
     }
     
+    func testThatItStoresThePreprocessedImageInTheCache() {
+        // given
+        let message = conversation.append(imageFromData: verySmallJPEGData()) as! ZMAssetClientMessage
+        
+        // when
+        sut.objectsDidChange(Set(arrayLiteral: message))
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        // then
+        XCTAssertEqual(uiMOC.preprocessedAssetCache.count, 1)
+    }
+    
+    func testThatItReusesThePreprocessedImageForTheSameImage() {
+        // given
+        let firstMessage = conversation.append(imageFromData: verySmallJPEGData()) as! ZMAssetClientMessage
+        sut.objectsDidChange(Set(arrayLiteral: firstMessage))
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        let otherConversation = ZMConversation.insertNewObject(in: uiMOC)
+        otherConversation.remoteIdentifier = UUID()
+        let secondMessage = otherConversation.append(imageFromData: verySmallJPEGData()) as! ZMAssetClientMessage
+        
+        // when
+        sut.objectsDidChange(Set(arrayLiteral: secondMessage))
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        // then
+        let asset = secondMessage.assets.first!
+        XCTAssertTrue(asset.hasPreprocessed)
+        XCTAssertTrue(asset.hasEncrypted)
+        XCTAssertEqual(asset.preprocessed, firstMessage.assets.first!.preprocessed)
+        XCTAssertEqual(uiMOC.preprocessedAssetCache.count, 1)
+    }
+    
+    func testThatItPreprocessesTheSameImageSentTwiceAtOnce() {
+        // given
+        let firstMessage = conversation.append(imageFromData: verySmallJPEGData()) as! ZMAssetClientMessage
+        let secondMessage = conversation.append(imageFromData: verySmallJPEGData()) as! ZMAssetClientMessage
+        
+        // when
+        sut.objectsDidChange(Set(arrayLiteral: firstMessage, secondMessage))
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        // then
+        for message in [firstMessage, secondMessage] {
+            XCTAssertTrue(message.assets.first!.hasPreprocessed)
+            XCTAssertTrue(message.assets.first!.hasEncrypted)
+        }
+    }
+    
+    func testThatItCancelsThePreprocessingOfACancelledMessage() {
+        // given
+        let message = conversation.append(imageFromData: verySmallJPEGData()) as! ZMAssetClientMessage
+        uiMOC.imagePreprocessingQueue.isSuspended = true
+        sut.objectsDidChange(Set(arrayLiteral: message))
+        
+        // when
+        message.transferState = .uploadingCancelled
+        sut.objectsDidChange(Set(arrayLiteral: message))
+        uiMOC.imagePreprocessingQueue.isSuspended = false
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        // then
+        XCTAssertFalse(message.assets.first!.hasPreprocessed)
+        XCTAssertEqual(uiMOC.preprocessedAssetCache.count, 0)
+    }
+    
 }
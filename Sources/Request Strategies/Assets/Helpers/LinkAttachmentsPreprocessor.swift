@@ -9,8 +9,11 @@ import WireUtilities
 public final class LinkAttachmentDetectorHelper : NSObject {
     fileprivate static var _test_debug_linkAttachmentDetector : LinkAttachmentDetectorType? = nil
 
+    /// Created once and shared, instead of for every preprocessor
+    fileprivate static let sharedDetector = LinkAttachmentDetector()
+
     public class func defaultDetector() -> LinkAttachmentDetectorType {
-        return test_debug_linkAttachmentDetector() ?? LinkAttachmentDetector()
+        return test_debug_linkAttachmentDetector() ?? sharedDetector
     }
 
     public class func test_debug_linkAttachmentDetector() -> LinkAttachmentDetectorType? {
@@ -47,13 +50,8 @@ public final class LinkAttachmentDetectorHelper : NSObject {
         return message.needsLinkAttachmentsUpdate ? message : nil
     }
 
-    override func processLinks(in message: ZMClientMessage, text: String, excluding excludedRanges: [NSRange]) {
-        linkAttachmentDetector.downloadLinkAttachments(inText: text, excluding: excludedRanges) { [weak self] linkAttachments in
-            message.managedObjectContext?.performGroupedBlock {
-                self?.zmLog.debug("\(linkAttachments.count) attachments for: \(message.nonce?.uuidString ?? "nil")\n\(linkAttachments)")
-                self?.didProcessMessage(message, result: linkAttachments)
-            }
-        }
+    override func downloadMetadata(inText text: String, excluding excludedRanges: [NSRange], completion: @escaping ([LinkAttachment]) -> Void) {
+        linkAttachmentDetector.downloadLinkAttachments(inText: text, excluding: excludedRanges, completion: completion)
     }
 
     override func didProcessMessage(_ message: ZMClientMessage, result linkAttachments: [LinkAttachment]) {
@@ -75,4 +73,35 @@ public final class LinkAttachmentDetectorHelper : NSObject {
         managedObjectContext.enqueueDelayedSave()
     }
 
+    // MARK: - Link metadata cache
+
+    override func cacheKey(for link: DetectedLink) -> String {
+        return "attachment|" + link.url
+    }
+
+    override func cacheEntry(for linkAttachments: [LinkAttachment], link: NSRange) -> Data? {
+        let attachments = linkAttachments
+            .filter { NSIntersectionRange($0.originalRange, link).length > 0 }
+            .map { $0.movingOriginalRange(by: -link.location) }
+        guard !attachments.isEmpty else { return nil }
+        return NSKeyedArchiver.archivedData(withRootObject: attachments)
+    }
+
+    override func didProcessMessage(_ message: ZMClientMessage, cachedEntries: [(data: Data, range: NSRange)]) {
+        let linkAttachments = cachedEntries.flatMap { entry -> [LinkAttachment] in
+            let attachments = NSKeyedUnarchiver.unarchiveObject(with: entry.data) as? [LinkAttachment] ?? []
+            return attachments.map { $0.movingOriginalRange(by: entry.range.location) }
+        }
+        didProcessMessage(message, result: linkAttachments)
+    }
+
+}
+
+fileprivate extension LinkAttachment {
+
+    func movingOriginalRange(by offset: Int) -> LinkAttachment {
+        let range = NSRange(location: originalRange.location + offset, length: originalRange.length)
+        return LinkAttachment(type: type, title: title, permalink: permalink, thumbnails: thumbnails, originalRange: range)
+    }
+
 }
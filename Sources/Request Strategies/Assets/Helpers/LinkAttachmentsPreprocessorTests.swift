@@ -241,4 +241,36 @@ class LinkAttachmentsPreprocessorTests: MessagingTestBase {
         }
     }
 
+    // MARK: - Link metadata cache
+
+    func testThatItUsesTheCachedAttachmentsForALinkThatWasAlreadyResolved() {
+        var secondMessage: ZMClientMessage!
+        let link = "https://www.youtube.com/watch?v=hyTNGkBSjyo"
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.nextResult = [LinkAttachment(type: .youTubeVideo, title: "Pingu Season 1 Episode 1",
+                                                           permalink: URL(string: link)!,
+                                                           thumbnails: [self.thumbnailURL],
+                                                           originalRange: NSRange(location: 0, length: 43))]
+            self.sut.objectsDidChange([self.createMessage(text: link)])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // WHEN
+            self.mockDetector.nextResult = []
+            secondMessage = self.createMessage(text: "Watch this: \(link)")
+            self.sut.objectsDidChange([secondMessage])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertEqual(self.mockDetector.downloadCount, 1)
+            XCTAssertFalse(secondMessage.needsLinkAttachmentsUpdate)
+            guard let attachment = secondMessage.linkAttachments?.first else { return XCTFail("No attachment") }
+            XCTAssertEqual(attachment.permalink, URL(string: link)!)
+            XCTAssertEqual(attachment.originalRange, NSRange(location: 12, length: 43))
+        }
+    }
+
 }
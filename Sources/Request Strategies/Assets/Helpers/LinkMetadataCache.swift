@@ -0,0 +1,333 @@
+//
+
+import Foundation
+import CommonCrypto
+import WireDataModel
+
+private let LinkMetadataCacheKey = "LinkMetadataCacheKey"
+
+/// Cache of the link metadata resolved by the link preprocessors, keyed by URL.
+///
+/// The cache is shared by the preprocessors running on a context, so a link posted in several
+/// conversations is only fetched once. Entries are kept in memory and, if the cache has a directory,
+/// on disk until they are older than `timeToLive`. Running fetches are tracked as well, so that
+/// messages containing a link which is being fetched wait for that fetch instead of starting another one.
+///
+/// Persisted entries are limited to `maximumDiskSize`, the least recently used ones are removed first,
+/// and outdated ones are removed every `cleanupInterval`. The entries used by a message are removed
+/// when the message is deleted.
+///
+/// - note: All methods should be called from the queue of the context owning the cache
+public final class LinkMetadataCache: NSObject {
+
+    private final class Entry {
+        let data: Data
+        let date: Date
+
+        init(data: Data, date: Date) {
+            self.data = data
+            self.date = date
+        }
+    }
+
+    private struct DiskEntry {
+        let size: Int
+        let date: Date
+        var lastAccess: Date
+    }
+
+    /// Time after which an entry is considered outdated and the link is fetched again
+    public let timeToLive: TimeInterval
+
+    /// Size of the persisted entries above which the least recently used ones are removed
+    public let maximumDiskSize: Int
+
+    /// Interval at which outdated persisted entries are removed
+    public let cleanupInterval: TimeInterval
+
+    /// Directory of the persisted entries, `nil` if entries are only kept in memory
+    let directory: URL?
+
+    /// Entries by name, see `entryName(forKey:)`
+    private let memoryCache = NSCache<NSString, Entry>()
+    private var runningFetches: [String: [(Data?) -> Void]] = [:]
+    /// Shared so that a cache created for the same directory sees the pending writes
+    private static let fileQueue = DispatchQueue(label: "LinkMetadataCache", qos: .utility)
+    private static let messagesFileName = "messages.plist"
+    private let currentDate: () -> Date
+    private var lastCleanup: Date
+
+    // Only accessed on `fileQueue`
+    private var diskEntries: [String: DiskEntry] = [:]
+    private var diskSize = 0
+    /// Names of the entries used by a message, by message nonce
+    private var entriesByMessage: [String: Set<String>] = [:]
+
+    public init(directory: URL?,
+                timeToLive: TimeInterval = 24 * 60 * 60,
+                maximumDiskSize: Int = 5 * 1024 * 1024,
+                cleanupInterval: TimeInterval = 60 * 60,
+                currentDate: @escaping () -> Date = Date.init) {
+        self.directory = directory
+        self.timeToLive = timeToLive
+        self.maximumDiskSize = maximumDiskSize
+        self.cleanupInterval = cleanupInterval
+        self.currentDate = currentDate
+        self.lastCleanup = currentDate()
+        memoryCache.countLimit = 200
+        super.init()
+        if let directory = directory {
+            FileManager.default.createAndProtectDirectory(at: directory)
+            let now = lastCleanup
+            LinkMetadataCache.fileQueue.async {
+                self.loadIndex()
+                self.removeOutdatedEntries(now: now)
+            }
+        }
+    }
+
+    // MARK: - Entries
+
+    /// Returns the entry stored for the key, unless it is outdated
+    public func data(forKey key: String) -> Data? {
+        let name = LinkMetadataCache.entryName(forKey: key)
+        let now = currentDate()
+
+        if let entry = memoryCache.object(forKey: name as NSString) {
+            guard isValid(entry) else {
+                removeData(forKey: key)
+                return nil
+            }
+            if directory != nil {
+                LinkMetadataCache.fileQueue.async { self.diskEntries[name]?.lastAccess = now }
+            }
+            return entry.data
+        }
+
+        guard let entry = readEntry(named: name, accessedAt: now) else { return nil }
+        guard isValid(entry) else {
+            removeData(forKey: key)
+            return nil
+        }
+        memoryCache.setObject(entry, forKey: name as NSString)
+        return entry.data
+    }
+
+    public func store(_ data: Data, forKey key: String) {
+        let name = LinkMetadataCache.entryName(forKey: key)
+        let now = currentDate()
+        memoryCache.setObject(Entry(data: data, date: now), forKey: name as NSString)
+
+        if let url = fileURL(forName: name) {
+            LinkMetadataCache.fileQueue.async {
+                guard (try? data.write(to: url, options: [.atomic, .completeFileProtectionUntilFirstUserAuthentication])) != nil else { return }
+                self.setDiskEntry(DiskEntry(size: data.count, date: now, lastAccess: now), named: name)
+                self.trimDiskIfNeeded()
+            }
+        }
+        cleanUpIfNeeded(now: now)
+    }
+
+    public func removeData(forKey key: String) {
+        removeEntry(named: LinkMetadataCache.entryName(forKey: key))
+    }
+
+    public func removeAll() {
+        memoryCache.removeAllObjects()
+
+        LinkMetadataCache.fileQueue.sync {
+            diskEntries = [:]
+            diskSize = 0
+            entriesByMessage = [:]
+            guard let directory = directory else { return }
+            let files = (try? FileManager.default.contentsOfDirectory(at: directory, includingPropertiesForKeys: nil, options: [])) ?? []
+            files.forEach { try? FileManager.default.removeItem(at: $0) }
+        }
+    }
+
+    // MARK: - Messages
+
+    /// Records that the message uses the entry of the key, so that it is removed with the message
+    public func addKey(_ key: String, forMessageWithNonce nonce: UUID) {
+        let name = LinkMetadataCache.entryName(forKey: key)
+        LinkMetadataCache.fileQueue.async {
+            guard self.entriesByMessage[nonce.transportString(), default: []].insert(name).inserted else { return }
+            self.writeEntriesByMessage()
+        }
+    }
+
+    /// Removes the entries used by the message, once it is deleted
+    public func removeData(forMessageWithNonce nonce: UUID) {
+        LinkMetadataCache.fileQueue.sync {
+            guard let names = self.entriesByMessage.removeValue(forKey: nonce.transportString()) else { return }
+            names.forEach { self.removeEntryFromFileQueue(named: $0) }
+            self.writeEntriesByMessage()
+        }
+    }
+
+    // MARK: - Running fetches
+
+    public func isFetching(key: String) -> Bool {
+        return runningFetches[key] != nil
+    }
+
+    /// Marks the key as being fetched
+    public func beginFetch(forKey key: String) {
+        guard runningFetches[key] == nil else { return }
+        runningFetches[key] = []
+    }
+
+    /// Calls `completion` with the result of the running fetch for the key once it finishes
+    public func waitForFetch(forKey key: String, completion: @escaping (Data?) -> Void) {
+        guard runningFetches[key] != nil else { return completion(data(forKey: key)) }
+        runningFetches[key]?.append(completion)
+    }
+
+    /// Stores the result of the fetch, if any, and passes it to the ones waiting for it
+    public func finishFetch(forKey key: String, result: Data?) {
+        if let result = result {
+            store(result, forKey: key)
+        }
+        let completions = runningFetches.removeValue(forKey: key) ?? []
+        completions.forEach { $0(result) }
+    }
+
+    // MARK: - Cleanup
+
+    private func cleanUpIfNeeded(now: Date) {
+        guard now.timeIntervalSince(lastCleanup) >= cleanupInterval else { return }
+        lastCleanup = now
+        LinkMetadataCache.fileQueue.async { self.removeOutdatedEntries(now: now) }
+    }
+
+    /// Removes the outdated persisted entries and forgets the messages whose entries are all gone
+    private func removeOutdatedEntries(now: Date) {
+        for (name, entry) in diskEntries where now.timeIntervalSince(entry.date) >= timeToLive {
+            removeEntryFromFileQueue(named: name)
+        }
+
+        let isStored = { (name: String) in
+            self.diskEntries[name] != nil || self.memoryCache.object(forKey: name as NSString) != nil
+        }
+        let previousCount = entriesByMessage.count
+        entriesByMessage = entriesByMessage.mapValues { $0.filter(isStored) }.filter { !$0.value.isEmpty }
+        if entriesByMessage.count != previousCount {
+            writeEntriesByMessage()
+        }
+    }
+
+    /// Removes the least recently used entries until the persisted ones take three quarters of the
+    /// maximum size, so that they aren't sorted again on the next store
+    private func trimDiskIfNeeded() {
+        guard diskSize > maximumDiskSize else { return }
+        let targetSize = maximumDiskSize / 4 * 3
+        for (name, _) in diskEntries.sorted(by: { $0.value.lastAccess < $1.value.lastAccess }) {
+            guard diskSize > targetSize else { break }
+            removeEntryFromFileQueue(named: name)
+        }
+    }
+
+    // MARK: - Helpers
+
+    private func isValid(_ entry: Entry) -> Bool {
+        return currentDate().timeIntervalSince(entry.date) < timeToLive
+    }
+
+    private func removeEntry(named name: String) {
+        memoryCache.removeObject(forKey: name as NSString)
+        LinkMetadataCache.fileQueue.async { self.removeEntryFromFileQueue(named: name) }
+    }
+
+    private func removeEntryFromFileQueue(named name: String) {
+        memoryCache.removeObject(forKey: name as NSString)
+        setDiskEntry(nil, named: name)
+        guard let url = fileURL(forName: name) else { return }
+        try? FileManager.default.removeItem(at: url)
+    }
+
+    private func setDiskEntry(_ entry: DiskEntry?, named name: String) {
+        diskSize -= diskEntries[name]?.size ?? 0
+        diskEntries[name] = entry
+        diskSize += entry?.size ?? 0
+    }
+
+    private func readEntry(named name: String, accessedAt date: Date) -> Entry? {
+        guard let url = fileURL(forName: name) else { return nil }
+        return LinkMetadataCache.fileQueue.sync {
+            guard
+                let data = try? Data(contentsOf: url),
+                let attributes = try? FileManager.default.attributesOfItem(atPath: url.path),
+                let modificationDate = attributes[.modificationDate] as? Date else { return nil }
+            diskEntries[name]?.lastAccess = date
+            return Entry(data: data, date: modificationDate)
+        }
+    }
+
+    /// Reads the persisted entries and the messages using them
+    private func loadIndex() {
+        guard let directory = directory else { return }
+        let keys: Set<URLResourceKey> = [.fileSizeKey, .contentModificationDateKey]
+        let files = (try? FileManager.default.contentsOfDirectory(at: directory, includingPropertiesForKeys: Array(keys), options: [])) ?? []
+        for file in files where file.lastPathComponent != LinkMetadataCache.messagesFileName {
+            guard let values = try? file.resourceValues(forKeys: keys), let date = values.contentModificationDate else { continue }
+            setDiskEntry(DiskEntry(size: values.fileSize ?? 0, date: date, lastAccess: date), named: file.lastPathComponent)
+        }
+
+        if let url = messagesFileURL,
+           let data = try? Data(contentsOf: url),
+           let entriesByMessage = try? PropertyListDecoder().decode([String: Set<String>].self, from: data) {
+            self.entriesByMessage = entriesByMessage
+        }
+    }
+
+    private func writeEntriesByMessage() {
+        guard let url = messagesFileURL, let data = try? PropertyListEncoder().encode(entriesByMessage) else { return }
+        try? data.write(to: url, options: [.atomic, .completeFileProtectionUntilFirstUserAuthentication])
+    }
+
+    private var messagesFileURL: URL? {
+        return directory?.appendingPathComponent(LinkMetadataCache.messagesFileName)
+    }
+
+    private func fileURL(forName name: String) -> URL? {
+        return directory?.appendingPathComponent(name)
+    }
+
+    /// Keys contain URLs, entries are named after their hash instead
+    static func entryName(forKey key: String) -> String {
+        let data = Data(key.utf8)
+        var digest = [UInt8](repeating: 0, count: Int(CC_SHA256_DIGEST_LENGTH))
+        data.withUnsafeBytes { (bytes: UnsafeRawBufferPointer) in
+            _ = CC_SHA256(bytes.baseAddress, CC_LONG(data.count), &digest)
+        }
+        return digest.map { String(format: "%02x", $0) }.joined()
+    }
+}
+
+extension NSManagedObjectContext {
+
+    /// The link metadata cache shared by the link preprocessors running on this context.
+    /// Entries are persisted next to the store, or only kept in memory for stores without a file.
+    public var linkMetadataCache: LinkMetadataCache {
+        if let cache = userInfo[LinkMetadataCacheKey] as? LinkMetadataCache {
+            return cache
+        }
+        let cache = LinkMetadataCache(directory: linkMetadataCacheDirectory)
+        userInfo[LinkMetadataCacheKey] = cache
+        return cache
+    }
+
+    /// Removes the link metadata of the account, when it is logged out
+    @objc public func removeLinkMetadataCache() {
+        linkMetadataCache.removeAll()
+        userInfo.removeObject(forKey: LinkMetadataCacheKey)
+    }
+
+    /// In the directory of the store, which is protected and excluded from backups
+    private var linkMetadataCacheDirectory: URL? {
+        guard let storeURL = persistentStoreCoordinator?.persistentStores.first?.url,
+              storeURL.isFileURL,
+              storeURL.path != "/dev/null" else { return nil }
+        return storeURL.deletingLastPathComponent().appendingPathComponent("LinkMetadata", isDirectory: true)
+    }
+}
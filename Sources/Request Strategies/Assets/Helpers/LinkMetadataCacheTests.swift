@@ -0,0 +1,183 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class LinkMetadataCacheTests: XCTestCase {
+
+    var directory: URL!
+    var currentDate: Date!
+    var sut: LinkMetadataCache!
+
+    override func setUp() {
+        super.setUp()
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        currentDate = Date()
+        sut = createCache()
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(at: directory)
+        directory = nil
+        currentDate = nil
+        sut = nil
+        super.tearDown()
+    }
+
+    func createCache(directory: URL? = nil, maximumDiskSize: Int = 1024, cleanupInterval: TimeInterval = 60 * 60) -> LinkMetadataCache {
+        return LinkMetadataCache(directory: directory,
+                                 timeToLive: 60,
+                                 maximumDiskSize: maximumDiskSize,
+                                 cleanupInterval: cleanupInterval,
+                                 currentDate: { [unowned self] in self.currentDate })
+    }
+
+    func fileExists(forKey key: String) -> Bool {
+        return FileManager.default.fileExists(atPath: directory.appendingPathComponent(LinkMetadataCache.entryName(forKey: key)).path)
+    }
+
+    func testThatItReturnsStoredData() {
+        // WHEN
+        sut.store(Data("preview".utf8), forKey: "preview|http://example.com")
+
+        // THEN
+        XCTAssertEqual(sut.data(forKey: "preview|http://example.com"), Data("preview".utf8))
+        XCTAssertNil(sut.data(forKey: "preview|http://example.org"))
+    }
+
+    func testThatItDoesNotReturnOutdatedData() {
+        // GIVEN
+        sut.store(Data("preview".utf8), forKey: "key")
+
+        // WHEN
+        currentDate = currentDate.addingTimeInterval(61)
+
+        // THEN
+        XCTAssertNil(sut.data(forKey: "key"))
+    }
+
+    func testThatItReadsPersistedDataInANewCache() {
+        // GIVEN
+        sut = createCache(directory: directory)
+        sut.store(Data("preview".utf8), forKey: "key")
+        sut = nil
+
+        // WHEN
+        let newCache = createCache(directory: directory)
+
+        // THEN
+        XCTAssertEqual(newCache.data(forKey: "key"), Data("preview".utf8))
+    }
+
+    func testThatRemoveAllDiscardsPersistedData() {
+        // GIVEN
+        sut = createCache(directory: directory)
+        sut.store(Data("preview".utf8), forKey: "key")
+
+        // WHEN
+        sut.removeAll()
+
+        // THEN
+        XCTAssertNil(createCache(directory: directory).data(forKey: "key"))
+    }
+
+    func testThatItPassesTheResultOfARunningFetchToTheOnesWaitingForIt() {
+        // GIVEN
+        var results: [Data?] = []
+        sut.beginFetch(forKey: "key")
+        sut.waitForFetch(forKey: "key") { results.append($0) }
+        sut.waitForFetch(forKey: "key") { results.append($0) }
+        XCTAssertTrue(sut.isFetching(key: "key"))
+        XCTAssertTrue(results.isEmpty)
+
+        // WHEN
+        sut.finishFetch(forKey: "key", result: Data("preview".utf8))
+
+        // THEN
+        XCTAssertFalse(sut.isFetching(key: "key"))
+        XCTAssertEqual(results, [Data("preview".utf8), Data("preview".utf8)])
+        XCTAssertEqual(sut.data(forKey: "key"), Data("preview".utf8))
+    }
+
+    func testThatFailedFetchesAreNotStored() {
+        // GIVEN
+        var results: [Data?] = []
+        sut.beginFetch(forKey: "key")
+        sut.waitForFetch(forKey: "key") { results.append($0) }
+
+        // WHEN
+        sut.finishFetch(forKey: "key", result: nil)
+
+        // THEN
+        XCTAssertEqual(results, [nil])
+        XCTAssertNil(sut.data(forKey: "key"))
+    }
+
+    func testThatItRemovesTheLeastRecentlyUsedEntriesWhenThePersistedOnesExceedTheMaximumSize() {
+        // GIVEN
+        sut = createCache(directory: directory, maximumDiskSize: 100)
+        for key in ["a", "b", "c"] {
+            sut.store(Data(repeating: 0, count: 30), forKey: key)
+            currentDate = currentDate.addingTimeInterval(1)
+        }
+        XCTAssertNotNil(sut.data(forKey: "a"))
+        currentDate = currentDate.addingTimeInterval(1)
+
+        // WHEN
+        sut.store(Data(repeating: 0, count: 30), forKey: "d")
+
+        // THEN
+        let newCache = createCache(directory: directory, maximumDiskSize: 100)
+        XCTAssertNotNil(newCache.data(forKey: "a"))
+        XCTAssertNil(newCache.data(forKey: "b"))
+        XCTAssertNil(newCache.data(forKey: "c"))
+        XCTAssertNotNil(newCache.data(forKey: "d"))
+    }
+
+    func testThatItPeriodicallyRemovesOutdatedPersistedEntries() {
+        // GIVEN
+        sut = createCache(directory: directory, cleanupInterval: 60)
+        sut.store(Data("preview".utf8), forKey: "outdated")
+
+        // WHEN
+        currentDate = currentDate.addingTimeInterval(61)
+        sut.store(Data("preview".utf8), forKey: "key")
+
+        // THEN
+        XCTAssertNil(sut.data(forKey: "unknown key")) // read from disk after the pending cleanup
+        XCTAssertFalse(fileExists(forKey: "outdated"))
+        XCTAssertTrue(fileExists(forKey: "key"))
+    }
+
+    func testThatItRemovesTheEntriesUsedByADeletedMessage() {
+        // GIVEN
+        let nonce = UUID()
+        sut = createCache(directory: directory)
+        sut.store(Data("preview".utf8), forKey: "key")
+        sut.store(Data("other preview".utf8), forKey: "other key")
+        sut.addKey("key", forMessageWithNonce: nonce)
+
+        // WHEN
+        sut.removeData(forMessageWithNonce: nonce)
+
+        // THEN
+        XCTAssertNil(sut.data(forKey: "key"))
+        XCTAssertNotNil(sut.data(forKey: "other key"))
+        XCTAssertFalse(fileExists(forKey: "key"))
+    }
+
+    func testThatItRemovesTheEntriesUsedByAMessageRecordedByAPreviousCache() {
+        // GIVEN
+        let nonce = UUID()
+        sut = createCache(directory: directory)
+        sut.store(Data("preview".utf8), forKey: "key")
+        sut.addKey("key", forMessageWithNonce: nonce)
+        sut = createCache(directory: directory)
+
+        // WHEN
+        sut.removeData(forMessageWithNonce: nonce)
+
+        // THEN
+        XCTAssertNil(sut.data(forKey: "key"))
+    }
+}
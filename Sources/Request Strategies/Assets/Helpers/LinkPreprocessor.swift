@@ -3,6 +3,16 @@
 
 import Foundation
 
+/// Compiled once, `markdownLinkRanges(in:)` runs for every message with text
+private let markdownLinkRegex = try? NSRegularExpression(pattern: "\\[.+\\]\\((.+)\\)", options: [])
+private let linkDetector = try? NSDataDetector(types: NSTextCheckingResult.CheckingType.link.rawValue)
+
+/// A link found in the text of a message
+struct DetectedLink {
+    let url: String
+    let range: NSRange
+}
+
 @objcMembers public class LinkPreprocessor<Result>: NSObject, ZMContextChangeTracker {
 
     let managedObjectContext: NSManagedObjectContext
@@ -33,6 +43,7 @@ import Foundation
     // MARK: - Processing
 
     func processObjects(_ objects: Set<NSObject>) {
+        removeCachedMetadata(ofDeletedMessagesIn: objects)
         objects
             .compactMap(objectsToPreprocess)
             .filter(!objectsBeingProcessed.contains)
@@ -68,7 +79,78 @@ import Foundation
     }
 
     func processLinks(in message: ZMClientMessage, text: String, excluding excludedRanges: [NSRange]) {
-        fatalError("Subclasses need to override processLinks(inText:excluding:)")
+        // The metadata of ephemeral messages shouldn't outlive them, their links aren't looked up or cached
+        guard !message.isEphemeral else {
+            return download(for: message, text: text, excluding: excludedRanges, caching: [])
+        }
+
+        let links = linksToLookUp(in: detectedLinks(in: text, excluding: excludedRanges))
+        let cache = managedObjectContext.linkMetadataCache
+        if let nonce = message.nonce {
+            links.forEach { cache.addKey(cacheKey(for: $0), forMessageWithNonce: nonce) }
+        }
+
+        var entries: [(data: Data, range: NSRange)] = []
+        var missingLinks: [DetectedLink] = []
+        for link in links {
+            if let data = cache.data(forKey: cacheKey(for: link)) {
+                entries.append((data, link.range))
+            } else {
+                missingLinks.append(link)
+            }
+        }
+
+        if !links.isEmpty && missingLinks.isEmpty {
+            zmLog.debug("using cached metadata for: \(message.nonce?.uuidString ?? "nil")")
+            didProcessMessage(message, cachedEntries: entries)
+        } else if !links.isEmpty && missingLinks.allSatisfy({ cache.isFetching(key: cacheKey(for: $0)) }) {
+            zmLog.debug("waiting for running fetches for: \(message.nonce?.uuidString ?? "nil")")
+            var remainingFetches = missingLinks.count
+            var failedLinks: [DetectedLink] = []
+            for link in missingLinks {
+                cache.waitForFetch(forKey: cacheKey(for: link)) { [weak self] data in
+                    if let data = data {
+                        entries.append((data, link.range))
+                    } else {
+                        failedLinks.append(link)
+                    }
+                    remainingFetches -= 1
+                    guard remainingFetches == 0, let `self` = self else { return }
+                    if failedLinks.isEmpty {
+                        self.didProcessMessage(message, cachedEntries: entries.sorted { $0.range.location < $1.range.location })
+                    } else {
+                        // A failed fetch has nothing to share, the message downloads its links itself
+                        self.download(for: message, text: text, excluding: excludedRanges, caching: failedLinks)
+                    }
+                }
+            }
+        } else {
+            download(for: message, text: text, excluding: excludedRanges, caching: missingLinks)
+        }
+    }
+
+    /// Downloads the metadata of the links in the text and stores the ones of `links` in the cache
+    private func download(for message: ZMClientMessage, text: String, excluding excludedRanges: [NSRange], caching links: [DetectedLink]) {
+        let context = managedObjectContext
+        let cache = context.linkMetadataCache
+        let fetches = links.map { (key: cacheKey(for: $0), range: $0.range) }
+        fetches.forEach { cache.beginFetch(forKey: $0.key) }
+
+        downloadMetadata(inText: text, excluding: excludedRanges) { [weak self] results in
+            context.performGroupedBlock {
+                // The fetches are finished even without a preprocessor, so that the messages waiting for them continue
+                for fetch in fetches {
+                    cache.finishFetch(forKey: fetch.key, result: self?.cacheEntry(for: results, link: fetch.range))
+                }
+                guard let `self` = self else { return }
+                self.zmLog.debug("\(results.count) results for: \(message.nonce?.uuidString ?? "nil")\n\(results)")
+                self.didProcessMessage(message, result: results)
+            }
+        }
+    }
+
+    func downloadMetadata(inText text: String, excluding excludedRanges: [NSRange], completion: @escaping ([Result]) -> Void) {
+        fatalError("Subclasses need to override downloadMetadata(inText:excluding:completion:)")
     }
 
     func didProcessMessage(_ message: ZMClientMessage, result: [Result]) {
@@ -76,9 +158,52 @@ import Foundation
     }
 
     fileprivate func markdownLinkRanges(in text: String) -> [NSRange] {
-        guard let regex = try? NSRegularExpression(pattern: "\\[.+\\]\\((.+)\\)", options: []) else { return [] }
+        guard let regex = markdownLinkRegex else { return [] }
         let wholeRange = NSRange(text.startIndex ..< text.endIndex, in: text)
         return regex.matches(in: text, options: [], range: wholeRange).compactMap { $0.range(at: 0) }
     }
 
+    // MARK: - Link metadata cache
+
+    /// Deleted messages shouldn't leave the metadata of their links behind
+    func removeCachedMetadata(ofDeletedMessagesIn objects: Set<NSObject>) {
+        let cache = managedObjectContext.linkMetadataCache
+        for case let message as ZMClientMessage in objects where !message.isZombieObject && message.visibleInConversation == nil {
+            guard let nonce = message.nonce else { continue }
+            cache.removeData(forMessageWithNonce: nonce)
+        }
+    }
+
+    func detectedLinks(in text: String, excluding excludedRanges: [NSRange]) -> [DetectedLink] {
+        guard let detector = linkDetector else { return [] }
+        let wholeRange = NSRange(text.startIndex ..< text.endIndex, in: text)
+        return detector.matches(in: text, options: [], range: wholeRange).compactMap { match in
+            guard
+                let url = match.url?.absoluteString,
+                !excludedRanges.contains(where: { NSIntersectionRange($0, match.range).length > 0 }) else { return nil }
+            return DetectedLink(url: url, range: match.range)
+        }
+    }
+
+    /// The links of the message whose metadata is looked up in the cache.
+    /// If there are none, the metadata is downloaded without using the cache.
+    func linksToLookUp(in links: [DetectedLink]) -> [DetectedLink] {
+        return links
+    }
+
+    func cacheKey(for link: DetectedLink) -> String {
+        fatalError("Subclasses need to override cacheKey(for:)")
+    }
+
+    /// Returns the cache entry for the results belonging to the link in the text, `nil` if there are none.
+    /// Positions in the text should be stored relative to the position of the link.
+    func cacheEntry(for results: [Result], link: NSRange) -> Data? {
+        fatalError("Subclasses need to override cacheEntry(for:link:)")
+    }
+
+    /// Processes the message with the cache entries of its links and the ranges of those links in the text
+    func didProcessMessage(_ message: ZMClientMessage, cachedEntries: [(data: Data, range: NSRange)]) {
+        fatalError("Subclasses need to override didProcessMessage(_:cachedEntries:)")
+    }
+
 }
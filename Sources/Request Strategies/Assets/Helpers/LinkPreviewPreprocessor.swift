@@ -26,27 +26,71 @@ import WireUtilities
         return message.linkPreviewState == .waitingToBeProcessed ? message : nil
     }
 
-    override func processLinks(in message: ZMClientMessage, text: String, excluding excludedRanges: [NSRange]) {
-        linkPreviewDetector.downloadLinkPreviews(inText: text, excluding: excludedRanges) { [weak self] linkPreviews in
-            message.managedObjectContext?.performGroupedBlock {
-                self?.zmLog.debug("\(linkPreviews.count) previews for: \(message.nonce?.uuidString ?? "nil")\n\(linkPreviews)")
-                self?.didProcessMessage(message, result: linkPreviews)
-            }
-        }
+    override func downloadMetadata(inText text: String, excluding excludedRanges: [NSRange], completion: @escaping ([LinkMetadata]) -> Void) {
+        linkPreviewDetector.downloadLinkPreviews(inText: text, excluding: excludedRanges, completion: completion)
     }
 
     override func didProcessMessage(_ message: ZMClientMessage, result linkPreviews: [LinkMetadata]) {
+        let preview = linkPreviews.first
+        updateMessage(message, with: preview?.protocolBuffer, imageData: preview?.imageData.first)
+    }
+
+    // MARK: - Link metadata cache
+
+    private enum CacheEntryKey {
+        static let preview = "preview"
+        static let imageData = "imageData"
+    }
+
+    /// Only the preview of the first link is sent
+    override func linksToLookUp(in links: [DetectedLink]) -> [DetectedLink] {
+        return Array(links.prefix(1))
+    }
+
+    override func cacheKey(for link: DetectedLink) -> String {
+        return "preview|" + link.url
+    }
+
+    override func cacheEntry(for linkPreviews: [LinkMetadata], link: NSRange) -> Data? {
+        guard let preview = linkPreviews.first(where: { NSLocationInRange(Int($0.protocolBuffer.urlOffset), link) }) else { return nil }
+
+        let relativePreview = preview.protocolBuffer.toBuilder()
+            .setUrlOffset(preview.protocolBuffer.urlOffset - Int32(link.location))
+            .build()
+        var entry: [String: Any] = [CacheEntryKey.preview: relativePreview.data()]
+        entry[CacheEntryKey.imageData] = preview.imageData.first
+        return try? PropertyListSerialization.data(fromPropertyList: entry, format: .binary, options: 0)
+    }
+
+    override func didProcessMessage(_ message: ZMClientMessage, cachedEntries: [(data: Data, range: NSRange)]) {
+        guard
+            let cachedEntry = cachedEntries.first,
+            let entry = (try? PropertyListSerialization.propertyList(from: cachedEntry.data, options: [], format: nil)) as? [String: Any],
+            let previewData = entry[CacheEntryKey.preview] as? Data,
+            let relativePreview = ZMLinkPreview.parse(from: previewData) else {
+                return updateMessage(message, with: nil, imageData: nil)
+        }
+
+        let preview = relativePreview.toBuilder()
+            .setUrlOffset(relativePreview.urlOffset + Int32(cachedEntry.range.location))
+            .build()
+        updateMessage(message, with: preview, imageData: entry[CacheEntryKey.imageData] as? Data)
+    }
+
+    // MARK: - Helpers
+
+    private func updateMessage(_ message: ZMClientMessage, with preview: ZMLinkPreview?, imageData: Data?) {
         
         guard let managedObjectContext = message.managedObjectContext else {return}
         
         finishProcessing(message)
 
-        if let preview = linkPreviews.first, let messageText = message.textMessageData?.messageText, let mentions = message.textMessageData?.mentions, !message.isObfuscated {
-            let updatedText = ZMText.text(with: messageText, mentions: mentions, linkPreviews: [preview.protocolBuffer])
+        if let preview = preview, let messageText = message.textMessageData?.messageText, let mentions = message.textMessageData?.mentions, !message.isObfuscated {
+            let updatedText = ZMText.text(with: messageText, mentions: mentions, linkPreviews: [preview])
             let updatedMessage = ZMGenericMessage.message(content: updatedText, nonce: message.nonce!, expiresAfter: message.deletionTimeout)
             message.add(updatedMessage.data())
 
-            if let imageData = preview.imageData.first {
+            if let imageData = imageData {
                 zmLog.debug("image in linkPreview (need to upload), setting state to .downloaded for: \(message.nonce?.uuidString ?? "nil")")
                 managedObjectContext.zm_fileAssetCache.storeAssetData(message, format: .original, encrypted: false, data: imageData)
                 message.linkPreviewState = .downloaded
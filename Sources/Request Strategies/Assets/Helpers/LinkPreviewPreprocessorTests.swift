@@ -13,11 +13,18 @@ final class MockLinkDetector: LinkPreviewDetectorType {
     var nextResult = [LinkMetadata]()
     var downloadLinkPreviewsCallCount: Int = 0
     var excludedRanges: [NSRange] = []
+    var defersCompletion = false
+    var deferredCompletions: [() -> Void] = []
     
     func downloadLinkPreviews(inText text: String, excluding: [NSRange], completion: @escaping ([LinkMetadata]) -> Void) {
         downloadLinkPreviewsCallCount += 1
         excludedRanges = excluding
-        completion(nextResult)
+        let result = nextResult
+        if defersCompletion {
+            deferredCompletions.append { completion(result) }
+        } else {
+            completion(result)
+        }
     }
     
 }
@@ -273,3 +280,171 @@ extension LinkPreviewPreprocessorTests {
     
     
 }
+
+
+// MARK: - Link metadata cache
+extension LinkPreviewPreprocessorTests {
+
+    func createPreview(offset: Int = 0) -> LinkMetadata {
+        let URL = "http://www.example.com"
+        let preview = LinkMetadata(originalURLString: "www.example.com", permanentURLString: URL, resolvedURLString: URL, offset: offset)
+        preview.imageData = [.secureRandomData(length: 256)]
+        preview.imageURLs = [Foundation.URL(string: "http://www.example.com/image")!]
+        return preview
+    }
+
+    func testThatItUsesTheCachedPreviewForALinkThatWasAlreadyResolved() {
+        var firstMessage: ZMClientMessage!
+        var secondMessage: ZMClientMessage!
+        let preview = createPreview()
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.nextResult = [preview]
+            firstMessage = self.createMessage(text: "www.example.com")
+            self.sut.objectsDidChange([firstMessage])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // WHEN
+            self.mockDetector.nextResult = []
+            secondMessage = self.createMessage(text: "look at www.example.com")
+            self.sut.objectsDidChange([secondMessage])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertEqual(self.mockDetector.downloadLinkPreviewsCallCount, 1)
+            XCTAssertEqual(secondMessage.linkPreviewState, .downloaded)
+            let data = self.syncMOC.zm_fileAssetCache.assetData(secondMessage, format: .original, encrypted: false)
+            XCTAssertEqual(data, preview.imageData.first!)
+            guard let linkPreview = secondMessage.genericMessage?.text.linkPreview.first else { return XCTFail("No link preview") }
+            XCTAssertEqual(linkPreview.url, preview.protocolBuffer.url)
+            XCTAssertEqual(linkPreview.urlOffset, 8)
+        }
+    }
+
+    func testThatItWaitsForTheRunningFetchOfALink() {
+        var firstMessage: ZMClientMessage!
+        var secondMessage: ZMClientMessage!
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.defersCompletion = true
+            self.mockDetector.nextResult = [self.createPreview()]
+            firstMessage = self.createMessage(text: "www.example.com")
+            secondMessage = self.createMessage(text: "www.example.com")
+
+            // WHEN
+            self.sut.objectsDidChange([firstMessage])
+            self.sut.objectsDidChange([secondMessage])
+            self.mockDetector.deferredCompletions.forEach { $0() }
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertEqual(self.mockDetector.downloadLinkPreviewsCallCount, 1)
+            XCTAssertEqual(firstMessage.linkPreviewState, .downloaded)
+            XCTAssertEqual(secondMessage.linkPreviewState, .downloaded)
+        }
+    }
+
+    func testThatItDownloadsThePreviewItselfWhenTheRunningFetchFails() {
+        var secondMessage: ZMClientMessage!
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.defersCompletion = true
+            self.sut.objectsDidChange([self.createMessage(text: "www.example.com")])
+            secondMessage = self.createMessage(text: "www.example.com")
+            self.sut.objectsDidChange([secondMessage])
+
+            // WHEN
+            self.mockDetector.defersCompletion = false
+            self.mockDetector.nextResult = [self.createPreview()]
+            self.mockDetector.deferredCompletions.forEach { $0() }
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertEqual(self.mockDetector.downloadLinkPreviewsCallCount, 2)
+            XCTAssertEqual(secondMessage.linkPreviewState, .downloaded)
+        }
+    }
+
+    func testThatItDoesNotCacheThePreviewsOfEphemeralMessages() {
+        var message: ZMClientMessage!
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.nextResult = [self.createPreview()]
+            message = self.createMessage(text: "www.example.com", isEphemeral: true)
+
+            // WHEN
+            self.sut.objectsDidChange([message])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertEqual(message.linkPreviewState, .downloaded)
+            XCTAssertNil(self.syncMOC.linkMetadataCache.data(forKey: "preview|http://www.example.com"))
+        }
+    }
+
+    func testThatItDoesNotCacheMissingPreviews() {
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.sut.objectsDidChange([self.createMessage(text: "www.example.com")])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // WHEN
+            self.sut.objectsDidChange([self.createMessage(text: "www.example.com")])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertEqual(self.mockDetector.downloadLinkPreviewsCallCount, 2)
+        }
+    }
+
+    func testThatItFinishesTheFetchesOfALinkWhenThePreprocessorIsDeallocated() {
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.defersCompletion = true
+            self.sut.objectsDidChange([self.createMessage(text: "www.example.com")])
+            XCTAssertTrue(self.syncMOC.linkMetadataCache.isFetching(key: "preview|http://www.example.com"))
+
+            // WHEN
+            self.sut = nil
+            self.mockDetector.deferredCompletions.forEach { $0() }
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertFalse(self.syncMOC.linkMetadataCache.isFetching(key: "preview|http://www.example.com"))
+        }
+    }
+
+    func testThatItRemovesTheCachedPreviewsOfADeletedMessage() {
+        var message: ZMClientMessage!
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // GIVEN
+            self.mockDetector.nextResult = [self.createPreview()]
+            message = self.createMessage(text: "www.example.com")
+            self.sut.objectsDidChange([message])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // WHEN
+            message.hideForSelfUser()
+            self.sut.objectsDidChange([message])
+        }
+
+        self.syncMOC.performGroupedBlockAndWait {
+            // THEN
+            XCTAssertNil(self.syncMOC.linkMetadataCache.data(forKey: "preview|http://www.example.com"))
+        }
+    }
+}
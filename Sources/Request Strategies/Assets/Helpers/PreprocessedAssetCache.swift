@@ -0,0 +1,142 @@
+//
+
+import Foundation
+import CommonCrypto
+
+private let PreprocessedAssetCacheKey = "PreprocessedAssetCacheKey"
+
+/// Least recently used cache of preprocessed (downsampled) image assets,
+/// keyed by a hash of the original image and of the processing parameters.
+///
+/// Sending the same image again, e.g. when forwarding it to several conversations,
+/// reuses the downsampled image instead of running the downsample operations again.
+/// The cache is bounded by the total size of the preprocessed data it holds. Entries are kept in a
+/// doubly linked list ordered by use, so looking up, storing and evicting entries take constant time.
+///
+/// - note: All methods should be called from the queue of the context owning the cache
+public final class PreprocessedAssetCache: NSObject {
+
+    public struct Entry {
+        public let data: Data
+        public let properties: ZMIImageProperties
+    }
+
+    private final class Node {
+        let key: String
+        let entry: Entry
+        /// The node used before this one
+        weak var previous: Node?
+        /// The node used after this one
+        var next: Node?
+
+        init(key: String, entry: Entry) {
+            self.key = key
+            self.entry = entry
+        }
+    }
+
+    /// Maximum total size in bytes of the preprocessed data kept in the cache
+    public let maxSize: Int
+
+    private(set) var size: Int = 0
+    private var nodes: [String: Node] = [:]
+    /// Least recently used node, the head of the list
+    private var leastRecentlyUsed: Node?
+    /// Most recently used node, the tail of the list
+    private weak var mostRecentlyUsed: Node?
+
+    public init(maxSize: Int = 20 * 1024 * 1024) {
+        self.maxSize = maxSize
+        super.init()
+    }
+
+    public var count: Int {
+        return nodes.count
+    }
+
+    /// Returns the key under which the result of preprocessing `original` into `formats` is stored
+    public static func key(forOriginal original: Data, formats: NSOrderedSet) -> String {
+        var digest = [UInt8](repeating: 0, count: Int(CC_SHA256_DIGEST_LENGTH))
+        original.withUnsafeBytes { (bytes: UnsafeRawBufferPointer) in
+            _ = CC_SHA256(bytes.baseAddress, CC_LONG(original.count), &digest)
+        }
+        let parameters = formats.array.map { "\($0)" }
+        return Data(digest).base64EncodedString() + "|" + parameters.joined(separator: ",")
+    }
+
+    public func entry(forKey key: String) -> Entry? {
+        guard let node = nodes[key] else { return nil }
+        unlink(node)
+        append(node)
+        return node.entry
+    }
+
+    public func store(_ data: Data, properties: ZMIImageProperties, forKey key: String) {
+        guard data.count <= maxSize else { return }
+
+        removeEntry(forKey: key)
+        let node = Node(key: key, entry: Entry(data: data, properties: properties))
+        nodes[key] = node
+        append(node)
+        size += data.count
+
+        while size > maxSize, let leastRecentlyUsed = leastRecentlyUsed {
+            removeEntry(forKey: leastRecentlyUsed.key)
+        }
+    }
+
+    public func removeAll() {
+        nodes.removeAll()
+        leastRecentlyUsed = nil
+        mostRecentlyUsed = nil
+        size = 0
+    }
+
+    // MARK: - Helpers
+
+    /// Adds the node at the most recently used end of the list
+    private func append(_ node: Node) {
+        node.previous = mostRecentlyUsed
+        node.next = nil
+        if let tail = mostRecentlyUsed {
+            tail.next = node
+        } else {
+            leastRecentlyUsed = node
+        }
+        mostRecentlyUsed = node
+    }
+
+    private func unlink(_ node: Node) {
+        if let previous = node.previous {
+            previous.next = node.next
+        } else {
+            leastRecentlyUsed = node.next
+        }
+        if let next = node.next {
+            next.previous = node.previous
+        } else {
+            mostRecentlyUsed = node.previous
+        }
+        node.previous = nil
+        node.next = nil
+    }
+
+    private func removeEntry(forKey key: String) {
+        guard let node = nodes.removeValue(forKey: key) else { return }
+        unlink(node)
+        size -= node.entry.data.count
+    }
+}
+
+extension NSManagedObjectContext {
+
+    /// The cache of preprocessed assets shared by the preprocessors running on this context
+    public var preprocessedAssetCache: PreprocessedAssetCache {
+        if let cache = userInfo[PreprocessedAssetCacheKey] as? PreprocessedAssetCache {
+            return cache
+        }
+        let cache = PreprocessedAssetCache()
+        userInfo[PreprocessedAssetCacheKey] = cache
+        return cache
+    }
+}
@@ -0,0 +1,102 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class PreprocessedAssetCacheTests: XCTestCase {
+    
+    var sut: PreprocessedAssetCache!
+    let properties = ZMIImageProperties(size: CGSize(width: 10, height: 10), length: 10, mimeType: "image/jpeg")!
+    
+    override func setUp() {
+        super.setUp()
+        sut = PreprocessedAssetCache(maxSize: 30)
+    }
+    
+    override func tearDown() {
+        sut = nil
+        super.tearDown()
+    }
+    
+    func testThatItReturnsStoredEntries() {
+        // given
+        let data = Data(count: 10)
+        
+        // when
+        sut.store(data, properties: properties, forKey: "a")
+        
+        // then
+        XCTAssertEqual(sut.entry(forKey: "a")?.data, data)
+        XCTAssertNil(sut.entry(forKey: "b"))
+    }
+    
+    func testThatItEvictsTheLeastRecentlyUsedEntry() {
+        // given
+        sut.store(Data(count: 10), properties: properties, forKey: "a")
+        sut.store(Data(count: 10), properties: properties, forKey: "b")
+        sut.store(Data(count: 10), properties: properties, forKey: "c")
+        _ = sut.entry(forKey: "a")
+        
+        // when
+        sut.store(Data(count: 10), properties: properties, forKey: "d")
+        
+        // then
+        XCTAssertNotNil(sut.entry(forKey: "a"))
+        XCTAssertNil(sut.entry(forKey: "b"))
+        XCTAssertNotNil(sut.entry(forKey: "c"))
+        XCTAssertNotNil(sut.entry(forKey: "d"))
+        XCTAssertEqual(sut.size, 30)
+    }
+    
+    func testThatItKeepsTheUsageOrderWhenAnEntryInTheMiddleIsUsed() {
+        // given
+        sut.store(Data(count: 10), properties: properties, forKey: "a")
+        sut.store(Data(count: 10), properties: properties, forKey: "b")
+        sut.store(Data(count: 10), properties: properties, forKey: "c")
+        _ = sut.entry(forKey: "b")
+        
+        // when
+        sut.store(Data(count: 10), properties: properties, forKey: "d")
+        sut.store(Data(count: 10), properties: properties, forKey: "e")
+        
+        // then
+        XCTAssertNil(sut.entry(forKey: "a"))
+        XCTAssertNil(sut.entry(forKey: "c"))
+        XCTAssertNotNil(sut.entry(forKey: "b"))
+        XCTAssertNotNil(sut.entry(forKey: "d"))
+        XCTAssertNotNil(sut.entry(forKey: "e"))
+        XCTAssertEqual(sut.count, 3)
+    }
+    
+    func testThatItDoesNotStoreEntriesLargerThanTheCache() {
+        // when
+        sut.store(Data(count: 31), properties: properties, forKey: "a")
+        
+        // then
+        XCTAssertEqual(sut.count, 0)
+        XCTAssertEqual(sut.size, 0)
+    }
+    
+    func testThatItReplacesEntriesWithTheSameKey() {
+        // when
+        sut.store(Data(count: 10), properties: properties, forKey: "a")
+        sut.store(Data(count: 20), properties: properties, forKey: "a")
+        
+        // then
+        XCTAssertEqual(sut.count, 1)
+        XCTAssertEqual(sut.size, 20)
+    }
+    
+    func testThatTheKeyDependsOnTheContentAndTheFormats() {
+        let original = Data([1, 2, 3])
+        let medium = NSOrderedSet(array: [ZMImageFormat.medium.rawValue])
+        let originalFormat = NSOrderedSet(array: [ZMImageFormat.original.rawValue])
+        
+        XCTAssertEqual(PreprocessedAssetCache.key(forOriginal: original, formats: medium),
+                       PreprocessedAssetCache.key(forOriginal: Data([1, 2, 3]), formats: medium))
+        XCTAssertNotEqual(PreprocessedAssetCache.key(forOriginal: original, formats: medium),
+                          PreprocessedAssetCache.key(forOriginal: Data([1, 2, 4]), formats: medium))
+        XCTAssertNotEqual(PreprocessedAssetCache.key(forOriginal: original, formats: medium),
+                          PreprocessedAssetCache.key(forOriginal: original, formats: originalFormat))
+    }
+}
@@ -0,0 +1,210 @@
+//
+
+import Foundation
+import CommonCrypto
+import WireDataModel
+
+private let zmLog = ZMSLog(tag: "Asset V3")
+
+/// Decrypts downloaded assets in fixed-size chunks into a file.
+///
+/// Encrypted assets are the AES-256-CBC ciphertext prefixed with its IV, and their SHA-256 digest covers
+/// the IV and the ciphertext. The ciphertext is read on a background queue in two passes: the first one
+/// checks the digest, and only a ciphertext that matches is decrypted chunk by chunk into a file, so no
+/// unverified plaintext is ever written and neither the context queue nor a second copy of the asset
+/// in memory is needed.
+///
+/// Decrypted files are written into a protected directory and only stay there until they are stored.
+/// Files left over by a previous run, e.g. one that crashed while decrypting, are removed the first time
+/// a decryptor uses the directory.
+final class StreamingAssetDecryptor {
+
+    enum Error: Swift.Error {
+        case cannotCreateFile
+        case cannotReadContent
+        case decryptionFailed
+        case digestMismatch
+    }
+
+    /// Opens a new stream over the ciphertext, each pass over the ciphertext reads its own stream
+    typealias CiphertextSource = () -> InputStream?
+
+    static let chunkSize = 64 * 1024
+
+    static let defaultDirectory = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0].appendingPathComponent("AssetDownloads/Decrypted", isDirectory: true)
+
+    private static let fileAttributes: [FileAttributeKey: Any] = [.protectionKey: FileProtectionType.completeUntilFirstUserAuthentication]
+    private static var preparedDirectories = Set<URL>()
+    private static let preparedDirectoriesLock = NSLock()
+
+    let directory: URL
+    private let queue = DispatchQueue(label: "StreamingAssetDecryptor", qos: .utility)
+
+    init(directory: URL = StreamingAssetDecryptor.defaultDirectory) {
+        self.directory = directory
+        StreamingAssetDecryptor.prepare(directory)
+    }
+
+    /// Removes the files left over in the directory and creates it with file protection, once per process
+    private static func prepare(_ directory: URL) {
+        preparedDirectoriesLock.lock()
+        defer { preparedDirectoriesLock.unlock() }
+        guard !preparedDirectories.contains(directory) else { return }
+        preparedDirectories.insert(directory)
+
+        try? FileManager.default.removeItem(at: directory)
+        try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: fileAttributes)
+    }
+
+    /// Decrypts the ciphertext on a background queue and calls the completion on that queue
+    /// with the URL of the plaintext file, or nil if it can't be decrypted.
+    /// The caller owns the file and has to remove it once it is stored.
+    func decrypt(_ ciphertext: @escaping CiphertextSource, key: Data, sha256: Data, completion: @escaping (URL?) -> Void) {
+        queue.async {
+            let url = self.directory.appendingPathComponent(UUID().uuidString)
+            do {
+                try StreamingAssetDecryptor.decrypt(ciphertext, key: key, sha256: sha256, to: url)
+                completion(url)
+            } catch {
+                zmLog.error("Failed to decrypt asset: \(error)")
+                completion(nil)
+            }
+        }
+    }
+
+    /// Checks the digest of the ciphertext and decrypts it into `url` if it matches.
+    /// Nothing is written if the digest doesn't match, and the file is removed if decrypting fails.
+    static func decrypt(_ ciphertext: CiphertextSource, key: Data, sha256: Data, to url: URL) throws {
+        guard let verifiedStream = ciphertext() else { throw Error.cannotReadContent }
+        guard try digest(of: verifiedStream) == sha256 else { throw Error.digestMismatch }
+
+        guard let stream = ciphertext() else { throw Error.cannotReadContent }
+        guard FileManager.default.createFile(atPath: url.path, contents: nil, attributes: fileAttributes),
+              let handle = try? FileHandle(forWritingTo: url) else {
+            throw Error.cannotCreateFile
+        }
+        defer { handle.closeFile() }
+
+        do {
+            try decrypt(stream, key: key, into: handle)
+        } catch {
+            try? FileManager.default.removeItem(at: url)
+            throw error
+        }
+    }
+
+    private static func digest(of ciphertext: InputStream) throws -> Data {
+        ciphertext.open()
+        defer { ciphertext.close() }
+
+        var hashContext = CC_SHA256_CTX()
+        CC_SHA256_Init(&hashContext)
+
+        var chunk = [UInt8](repeating: 0, count: chunkSize)
+        while true {
+            let count = read(ciphertext, into: &chunk, count: chunkSize)
+            guard count >= 0 else { throw Error.cannotReadContent }
+            guard count > 0 else { break }
+            CC_SHA256_Update(&hashContext, chunk, CC_LONG(count))
+        }
+
+        var digest = [UInt8](repeating: 0, count: Int(CC_SHA256_DIGEST_LENGTH))
+        CC_SHA256_Final(&digest, &hashContext)
+        return Data(digest)
+    }
+
+    private static func decrypt(_ ciphertext: InputStream, key: Data, into handle: FileHandle) throws {
+        ciphertext.open()
+        defer { ciphertext.close() }
+
+        let ivLength = kCCBlockSizeAES128
+        var iv = [UInt8](repeating: 0, count: ivLength)
+        guard read(ciphertext, into: &iv, count: ivLength) == ivLength else { throw Error.cannotReadContent }
+
+        var cryptor: CCCryptorRef?
+        let status = key.withUnsafeBytes { keyBytes in
+            CCCryptorCreate(CCOperation(kCCDecrypt), CCAlgorithm(kCCAlgorithmAES), CCOptions(kCCOptionPKCS7Padding),
+                            keyBytes.baseAddress, key.count, iv, &cryptor)
+        }
+        guard status == kCCSuccess, let decryptor = cryptor else { throw Error.decryptionFailed }
+        defer { CCCryptorRelease(decryptor) }
+
+        var chunk = [UInt8](repeating: 0, count: chunkSize)
+        let plaintextCapacity = chunkSize + kCCBlockSizeAES128
+        var plaintext = [UInt8](repeating: 0, count: plaintextCapacity)
+        var plaintextLength = 0
+
+        while true {
+            let count = read(ciphertext, into: &chunk, count: chunkSize)
+            guard count >= 0 else { throw Error.cannotReadContent }
+            guard count > 0 else { break }
+
+            guard CCCryptorUpdate(decryptor, chunk, count, &plaintext, plaintextCapacity, &plaintextLength) == kCCSuccess else {
+                throw Error.decryptionFailed
+            }
+            handle.write(Data(plaintext[0..<plaintextLength]))
+        }
+
+        guard CCCryptorFinal(decryptor, &plaintext, plaintextCapacity, &plaintextLength) == kCCSuccess else {
+            throw Error.decryptionFailed
+        }
+        handle.write(Data(plaintext[0..<plaintextLength]))
+    }
+
+    /// Reads until `count` bytes are read or the stream ends.
+    /// - returns: the number of bytes read, or -1 if the stream failed
+    private static func read(_ stream: InputStream, into buffer: inout [UInt8], count: Int) -> Int {
+        var total = 0
+        while total < count {
+            let read = buffer.withUnsafeMutableBufferPointer { bytes in
+                stream.read(bytes.baseAddress! + total, maxLength: count - total)
+            }
+            guard read > 0 else { return read < 0 ? -1 : total }
+            total += read
+        }
+        return total
+    }
+}
+
+extension StreamingAssetDecryptor {
+
+    /// Decrypts a downloaded asset and calls the completion on the context with the URL of the plaintext file.
+    /// The dispatch group of the context is entered while decrypting.
+    func decrypt(_ ciphertext: Data, key: Data, sha256: Data, on context: NSManagedObjectContext, completion: @escaping (URL?) -> Void) {
+        decrypt({ InputStream(data: ciphertext) }, key: key, sha256: sha256, on: context, completion: completion)
+    }
+
+    private func decrypt(_ ciphertext: @escaping CiphertextSource, key: Data, sha256: Data, on context: NSManagedObjectContext, completion: @escaping (URL?) -> Void) {
+        let group = context.dispatchGroup
+        group?.enter()
+        decrypt(ciphertext, key: key, sha256: sha256) { url in
+            context.performGroupedBlock {
+                completion(url)
+                group?.leave()
+            }
+        }
+    }
+
+    /// Stores the plaintext file as the decrypted asset of the message and removes it.
+    /// Files are moved into the location of the cache entry, so storing them never reads the asset into
+    /// memory. Images are stored under a format, which the cache only takes as data, they are bounded
+    /// by the size of the images the clients send.
+    static func store(plaintextAt url: URL, for message: ZMConversationMessage, format: ZMImageFormat? = nil, in cache: FileAssetCache) {
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        if let format = format {
+            guard let data = try? Data(contentsOf: url) else { return }
+            cache.storeAssetData(message, format: format, encrypted: false, data: data)
+            return
+        }
+
+        // The cache creates the entry, whose file is then replaced by the plaintext file
+        cache.storeAssetData(message, encrypted: false, data: Data())
+        guard let destination = cache.accessAssetURL(message),
+              (try? FileManager.default.replaceItemAt(destination, withItemAt: url)) != nil else {
+            zmLog.error("Failed to move the decrypted asset into the cache")
+            cache.deleteAssetData(message)
+            return
+        }
+    }
+}
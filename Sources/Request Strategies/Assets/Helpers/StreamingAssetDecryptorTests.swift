@@ -0,0 +1,82 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+class StreamingAssetDecryptorTests: XCTestCase {
+
+    var directory: URL!
+
+    override func setUp() {
+        super.setUp()
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(at: directory)
+        directory = nil
+        super.tearDown()
+    }
+
+    func testThatItDecryptsAnAssetSpanningSeveralChunks() throws {
+        // given
+        let plaintext = Data.secureRandomData(length: 3 * 64 * 1024 + 17)
+        let key = Data.randomEncryptionKey()
+        let ciphertext = plaintext.zmEncryptPrefixingPlainTextIV(key: key)
+        let url = directory.appendingPathComponent("plaintext")
+
+        // when
+        try StreamingAssetDecryptor.decrypt({ InputStream(data: ciphertext) }, key: key, sha256: ciphertext.zmSHA256Digest(), to: url)
+
+        // then
+        XCTAssertEqual(try Data(contentsOf: url), plaintext)
+    }
+
+    func testThatItDoesNotDecryptWhenTheDigestDoesNotMatch() {
+        // given
+        let key = Data.randomEncryptionKey()
+        let ciphertext = Data.secureRandomData(length: 500).zmEncryptPrefixingPlainTextIV(key: key)
+        let url = directory.appendingPathComponent("plaintext")
+        var openedStreams = 0
+
+        // when
+        XCTAssertThrowsError(try StreamingAssetDecryptor.decrypt({ openedStreams += 1; return InputStream(data: ciphertext) }, key: key, sha256: Data.randomEncryptionKey(), to: url))
+
+        // then
+        XCTAssertEqual(openedStreams, 1)
+        XCTAssertFalse(FileManager.default.fileExists(atPath: url.path))
+    }
+
+    func testThatItRemovesLeftoverFilesWhenFirstUsingTheDirectory() throws {
+        // given
+        let leftoverDirectory = directory.appendingPathComponent("Decrypted", isDirectory: true)
+        try FileManager.default.createDirectory(at: leftoverDirectory, withIntermediateDirectories: true, attributes: nil)
+        let leftover = leftoverDirectory.appendingPathComponent("leftover")
+        try Data("plaintext".utf8).write(to: leftover)
+
+        // when
+        _ = StreamingAssetDecryptor(directory: leftoverDirectory)
+
+        // then
+        XCTAssertFalse(FileManager.default.fileExists(atPath: leftover.path))
+        XCTAssertTrue(FileManager.default.fileExists(atPath: leftoverDirectory.path))
+    }
+
+    func testThatItCallsTheCompletionWithThePlaintextFile() {
+        // given
+        let sut = StreamingAssetDecryptor(directory: directory)
+        let plaintext = Data.secureRandomData(length: 500)
+        let key = Data.randomEncryptionKey()
+        let ciphertext = plaintext.zmEncryptPrefixingPlainTextIV(key: key)
+        let expectation = self.expectation(description: "decrypted")
+
+        // when
+        sut.decrypt({ InputStream(data: ciphertext) }, key: key, sha256: ciphertext.zmSHA256Digest()) { url in
+            // then
+            XCTAssertEqual(url.flatMap { try? Data(contentsOf: $0) }, plaintext)
+            expectation.fulfill()
+        }
+        waitForExpectations(timeout: 0.5)
+    }
+}
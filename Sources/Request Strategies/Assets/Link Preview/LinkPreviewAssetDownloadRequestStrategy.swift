@@ -8,6 +8,7 @@ import Foundation
     
     fileprivate var assetDownstreamObjectSync: ZMDownstreamObjectSyncWithWhitelist!
     fileprivate let assetRequestFactory = AssetDownloadRequestFactory()
+    private let decryptor = StreamingAssetDecryptor()
     private var notificationToken: Any? = nil
 
     public override init(withManagedObjectContext managedObjectContext: NSManagedObjectContext, applicationStatus: ApplicationStatus?) {
@@ -55,25 +56,23 @@ import Foundation
     
     func handleResponse(_ response: ZMTransportResponse!, forMessage message: ZMClientMessage) {
         guard response.result == .success else { return }
-        let cache = managedObjectContext.zm_fileAssetCache
         
         let linkPreview = message.genericMessage?.linkPreviews.first
         guard let remote = linkPreview?.remote, let data = response.rawData else { return }
-        cache.storeAssetData(message, format: .medium, encrypted: true, data: data)
 
-        let success = cache.decryptImageIfItMatchesDigest(
-            message,
-            format: .medium,
-            encryptionKey: remote.otrKey,
-            sha256Digest: remote.sha256
-        )
-        
-        guard success else { return }
-        
-        guard let uiMOC = managedObjectContext.zm_userInterface else { return }
-        NotificationDispatcher.notifyNonCoreDataChanges(objectID: message.objectID,
-                                                        changedKeys: [ZMClientMessageLinkPreviewKey, #keyPath(ZMAssetClientMessage.hasDownloadedPreview)],
-                                                        uiContext: uiMOC)
+        decryptor.decrypt(data, key: remote.otrKey, sha256: remote.sha256, on: managedObjectContext) { [weak self] url in
+            guard let url = url else { return }
+            guard let `self` = self, !message.isZombieObject else {
+                try? FileManager.default.removeItem(at: url)
+                return
+            }
+            StreamingAssetDecryptor.store(plaintextAt: url, for: message, format: .medium, in: self.managedObjectContext.zm_fileAssetCache)
+            
+            guard let uiMOC = self.managedObjectContext.zm_userInterface else { return }
+            NotificationDispatcher.notifyNonCoreDataChanges(objectID: message.objectID,
+                                                            changedKeys: [ZMClientMessageLinkPreviewKey, #keyPath(ZMAssetClientMessage.hasDownloadedPreview)],
+                                                            uiContext: uiMOC)
+        }
     }
 
 }
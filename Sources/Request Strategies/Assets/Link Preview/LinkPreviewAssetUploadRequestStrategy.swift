@@ -33,7 +33,7 @@ extension ZMImagePreprocessingTracker {
         
         let previewImagePreprocessor = ZMImagePreprocessingTracker(
             managedObjectContext:       managedObjectContext,
-            imageProcessingQueue:       OperationQueue(),
+            imageProcessingQueue:       managedObjectContext.imagePreprocessingQueue,
             fetch:             imageFetchPredicate,
             needsProcessingPredicate:   needsProccessing,
             entityClass:                ZMClientMessage.self
@@ -7,16 +7,37 @@ private let zmLog = ZMSLog(tag: "Request Configuration")
 
 @objcMembers open class AbstractRequestStrategy : NSObject, RequestStrategy {
     
-    weak public var applicationStatus : ApplicationStatus?
+    /// Requests returned by the strategies which didn't complete yet
+    private static let requestQueueDepth = Metrics.shared.gauge("request_queue_depth", event: Metrics.requestStrategyEvent)
+    
+    weak public var applicationStatus : ApplicationStatus? {
+        didSet {
+            gatingState = applicationStatus?.requestGatingState
+            invalidateRequestGatingDecision()
+        }
+    }
     
     public let managedObjectContext : NSManagedObjectContext
     public var configuration : ZMStrategyConfigurationOption =
         [.allowsRequestsDuringSync,
-         .allowsRequestsDuringEventProcessing,.allowsRequestsDuringNotificationStreamFetch]
+         .allowsRequestsDuringEventProcessing,.allowsRequestsDuringNotificationStreamFetch] {
+        didSet {
+            invalidateRequestGatingDecision()
+        }
+    }
+    
+    /// Word of the gating state the last decision was made for, `UInt.max` is never published
+    private var gatingWord : UInt = .max
+    private var gatingState : RequestGatingState?
+    private var isAllowed = false
+    
+    /// Time from returning a request to its completion, looked up once per strategy
+    private lazy var requestLatency = Metrics.shared.histogram("\(type(of: self))_latency", event: Metrics.requestStrategyEvent)
     
     public init(withManagedObjectContext managedObjectContext: NSManagedObjectContext, applicationStatus: ApplicationStatus?) {
         self.managedObjectContext = managedObjectContext
         self.applicationStatus = applicationStatus
+        self.gatingState = applicationStatus?.requestGatingState
         
         super.init()
     }
@@ -26,21 +47,70 @@ private let zmLog = ZMSLog(tag: "Request Configuration")
         fatal("you must override this method")
     }
     
-    open func nextRequest() -> ZMTransportRequest? {
+    /// Whether the strategy is allowed to create requests in the current state of the application status.
+    /// Strategies which are not can be skipped until the word of the `RequestGatingState` changes.
+    public var allowsRequests : Bool {
+        // A status which goes away invalidates its gating state, which then doesn't allow requests
+        if let gatingState = gatingState {
+            let word = gatingState.word
+            if word != gatingWord {
+                updateGatingDecision(prerequisites: gatingState.prerequisites, word: word)
+            }
+            return isAllowed
+        }
+        
+        // The status doesn't publish its state, read it on each call
         guard let applicationStatus = self.applicationStatus else {
             zmLog.error("applicationStatus is missing")
-            return nil
+            return false
         }
-        
         let prerequisites = AbstractRequestStrategy.prerequisites(forApplicationStatus: applicationStatus)
+        if prerequisites.rawValue != gatingWord {
+            updateGatingDecision(prerequisites: prerequisites, word: prerequisites.rawValue)
+        }
+        return isAllowed
+    }
+    
+    open func nextRequest() -> ZMTransportRequest? {
+        guard allowsRequests else {
+            return nil
+        }
         
-        if prerequisites.isSubset(of: configuration) {
-            return nextRequestIfAllowed()
-        } else {
+        let request = nextRequestIfAllowed()
+        if let request = request {
+            recordLatency(of: request)
+        }
+        if let request = request, RequestTracer.shared.isEnabled {
+            RequestTracer.shared.request(request, returnedBy: self)
+        }
+        if let request = request, SessionRecorder.shared.isRecording {
+            SessionRecorder.shared.recordResponse(to: request, groupQueue: managedObjectContext)
+        }
+        return request
+    }
+    
+    private func recordLatency(of request: ZMTransportRequest) {
+        let startTime = CFAbsoluteTimeGetCurrent()
+        let latency = requestLatency
+        AbstractRequestStrategy.requestQueueDepth.increment(by: 1)
+        request.add(ZMCompletionHandler(on: managedObjectContext) { _ in
+            AbstractRequestStrategy.requestQueueDepth.increment(by: -1)
+            latency.record(since: startTime)
+        })
+    }
+    
+    private func updateGatingDecision(prerequisites: ZMStrategyConfigurationOption, word: UInt) {
+        gatingWord = word
+        isAllowed = prerequisites.isSubset(of: configuration)
+        if !isAllowed {
             zmLog.debug("Not performing requests since option: \(prerequisites.subtracting(configuration)) is not configured for (\(String(describing: type(of: self))))")
         }
-        
-        return nil
+    }
+    
+    /// The decision is cached until the state of the application status changes, subclasses
+    /// overriding `configuration` have to call this when it changes.
+    public func invalidateRequestGatingDecision() {
+        gatingWord = .max
     }
     
     public class func prerequisites(forApplicationStatus applicationStatus: ApplicationStatus) -> ZMStrategyConfigurationOption {
@@ -16,7 +16,11 @@ protocol TestableAbstractRequestStrategy : class {
 
 class TestRequestStrategyObjc : ZMAbstractRequestStrategy, TestableAbstractRequestStrategy {
     
-    internal var mutableConfiguration: ZMStrategyConfigurationOption = []
+    internal var mutableConfiguration: ZMStrategyConfigurationOption = [] {
+        didSet {
+            invalidateRequestGatingDecision()
+        }
+    }
 
     override func nextRequestIfAllowed() -> ZMTransportRequest? {
         return ZMTransportRequest(getFromPath: "dummy/request")
@@ -33,9 +37,15 @@ class TestRequestStrategyObjc : ZMAbstractRequestStrategy, TestableAbstractReque
 
 class TestRequestStrategy : AbstractRequestStrategy, TestableAbstractRequestStrategy {
     
-    internal var mutableConfiguration: ZMStrategyConfigurationOption = []
+    internal var mutableConfiguration: ZMStrategyConfigurationOption = [] {
+        didSet {
+            invalidateRequestGatingDecision()
+        }
+    }
+    var requestsCreated = 0
     
     override func nextRequestIfAllowed() -> ZMTransportRequest? {
+        requestsCreated += 1
         return ZMTransportRequest(getFromPath: "dummy/request")
     }
     
@@ -105,4 +115,202 @@ class AbstractRequestStrategyTests : MessagingTestBase {
         checkAllPermutations(on: TestRequestStrategyObjc(managedObjectContext: syncMOC, applicationStatus: mockApplicationStatus))
     }
     
+    func testAbstractRequestStrategyWithoutRequestGatingState() {
+        let applicationStatus = ApplicationStatusWithoutRequestGatingState(mockApplicationStatus)
+        withExtendedLifetime(applicationStatus) {
+            checkAllPermutations(on: TestRequestStrategy(withManagedObjectContext: syncMOC, applicationStatus: applicationStatus))
+        }
+    }
+    
+    func testAbstractRequestStrategyObjCWithoutRequestGatingState() {
+        let applicationStatus = ApplicationStatusWithoutRequestGatingState(mockApplicationStatus)
+        withExtendedLifetime(applicationStatus) {
+            checkAllPermutations(on: TestRequestStrategyObjc(managedObjectContext: syncMOC, applicationStatus: applicationStatus))
+        }
+    }
+    
+    // MARK: - Request gating state
+    
+    func testThatTheGatingStateWordOnlyChangesWhenThePrerequisitesChange() {
+        // given
+        let word = mockApplicationStatus.requestGatingState.word
+        
+        // when
+        mockApplicationStatus.mockSynchronizationState = .unauthenticated
+        mockApplicationStatus.mockOperationState = .foreground
+        
+        // then
+        XCTAssertEqual(mockApplicationStatus.requestGatingState.word, word)
+        XCTAssertEqual(mockApplicationStatus.requestGatingState.prerequisites, [.allowsRequestsWhileUnauthenticated])
+        
+        // when
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        
+        // then
+        XCTAssertNotEqual(mockApplicationStatus.requestGatingState.word, word)
+        XCTAssertEqual(mockApplicationStatus.requestGatingState.prerequisites, [.allowsRequestsDuringEventProcessing])
+    }
+    
+    func testThatTheGatingStateWordChangesWhenThePrerequisitesFlipBack() {
+        // given
+        let word = mockApplicationStatus.requestGatingState.word
+        
+        // when
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        mockApplicationStatus.mockSynchronizationState = .unauthenticated
+        
+        // then
+        XCTAssertNotEqual(mockApplicationStatus.requestGatingState.word, word)
+        XCTAssertEqual(mockApplicationStatus.requestGatingState.prerequisites, [.allowsRequestsWhileUnauthenticated])
+    }
+    
+    func testThatItDoesNotCreateRequestsUntilTheStateAllowsIt() {
+        // given
+        let sut = TestRequestStrategy(withManagedObjectContext: syncMOC, applicationStatus: mockApplicationStatus)
+        sut.mutableConfiguration = [.allowsRequestsDuringEventProcessing]
+        mockApplicationStatus.mockSynchronizationState = .synchronizing
+        XCTAssertFalse(sut.allowsRequests)
+        XCTAssertNil(sut.nextRequest())
+        
+        // when
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        
+        // then
+        XCTAssertTrue(sut.allowsRequests)
+        XCTAssertNotNil(sut.nextRequest())
+        XCTAssertEqual(sut.requestsCreated, 1)
+    }
+    
+    func testThatItReevaluatesTheDecisionWhenTheConfigurationChanges() {
+        // given
+        let sut = TestRequestStrategy(withManagedObjectContext: syncMOC, applicationStatus: mockApplicationStatus)
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        sut.mutableConfiguration = []
+        XCTAssertFalse(sut.allowsRequests)
+        
+        // when
+        sut.mutableConfiguration = [.allowsRequestsDuringEventProcessing]
+        
+        // then
+        XCTAssertTrue(sut.allowsRequests)
+    }
+    
+    func testThatTheFirstGatingStateWordReflectsTheStatus() {
+        // given
+        let applicationStatus = ApplicationStatusWithoutRequestGatingState(mockApplicationStatus)
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        mockApplicationStatus.mockOperationState = .background
+    
+        // when
+        let sut = RequestGatingState(applicationStatus: applicationStatus)
+    
+        // then
+        XCTAssertEqual(sut.prerequisites, AbstractRequestStrategy.prerequisites(forApplicationStatus: applicationStatus))
+        XCTAssertEqual(sut.word, sut.prerequisites.rawValue)
+    }
+    
+    func testThatTheGatingStateIgnoresUpdatesOnceInvalidated() {
+        // given
+        let sut = RequestGatingState(applicationStatus: mockApplicationStatus)
+        let word = sut.word
+    
+        // when
+        sut.invalidate()
+    
+        // then
+        XCTAssertTrue(sut.isInvalidated)
+        XCTAssertNotEqual(sut.word, word)
+    
+        // when
+        let invalidatedWord = sut.word
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        sut.update(from: mockApplicationStatus)
+    
+        // then
+        XCTAssertEqual(sut.word, invalidatedWord)
+    }
+    
+    func testThatItDoesNotAllowRequestsOnceTheStatusIsDeallocated() {
+        // given
+        var applicationStatus: MockApplicationStatus? = MockApplicationStatus()
+        applicationStatus?.mockSynchronizationState = .eventProcessing
+        let sut = TestRequestStrategy(withManagedObjectContext: syncMOC, applicationStatus: applicationStatus!)
+        sut.mutableConfiguration = [.allowsRequestsDuringEventProcessing]
+        XCTAssertTrue(sut.allowsRequests)
+    
+        // when
+        applicationStatus = nil
+    
+        // then
+        XCTAssertFalse(sut.allowsRequests)
+        XCTAssertNil(sut.nextRequest())
+    }
+    
+    func testThatItDoesNotAllowRequestsOnceTheStatusIsDeallocatedObjC() {
+        // given
+        var applicationStatus: MockApplicationStatus? = MockApplicationStatus()
+        applicationStatus?.mockSynchronizationState = .eventProcessing
+        let sut = TestRequestStrategyObjc(managedObjectContext: syncMOC, applicationStatus: applicationStatus!)
+        sut.mutableConfiguration = [.allowsRequestsDuringEventProcessing]
+        XCTAssertTrue(sut.allowsRequests)
+    
+        // when
+        applicationStatus = nil
+    
+        // then
+        XCTAssertFalse(sut.allowsRequests)
+    }
+    
+    // MARK: - Metrics
+    
+    func testThatItReportsTheRequestsInFlightAndTheirLatency() {
+        // given
+        let sut = TestRequestStrategy(withManagedObjectContext: syncMOC, applicationStatus: mockApplicationStatus)
+        sut.mutableConfiguration = [.allowsRequestsDuringEventProcessing]
+        mockApplicationStatus.mockSynchronizationState = .eventProcessing
+        let queueDepth = Metrics.shared.gauge("request_queue_depth", event: Metrics.requestStrategyEvent)
+        let latency = Metrics.shared.histogram("TestRequestStrategy_latency", event: Metrics.requestStrategyEvent)
+        let initialDepth = queueDepth.value
+        let initialLatencyCount = latency.counts.reduce(0, +)
+        
+        // when
+        let request = sut.nextRequest()
+        
+        // then
+        XCTAssertEqual(queueDepth.value, initialDepth + 1)
+        
+        // when
+        request?.complete(with: ZMTransportResponse(payload: nil, httpStatus: 200, transportSessionError: nil))
+        XCTAssertTrue(waitForAllGroupsToBeEmpty(withTimeout: 0.5))
+        
+        // then
+        XCTAssertEqual(queueDepth.value, initialDepth)
+        XCTAssertEqual(latency.counts.reduce(0, +), initialLatencyCount + 1)
+    }
+    
+}
+
+
+/// Forwards to a `MockApplicationStatus` without publishing its `RequestGatingState`
+private class ApplicationStatusWithoutRequestGatingState : NSObject, ApplicationStatus {
+    
+    let mockApplicationStatus : MockApplicationStatus
+    
+    init(_ mockApplicationStatus: MockApplicationStatus) {
+        self.mockApplicationStatus = mockApplicationStatus
+        super.init()
+    }
+    
+    var synchronizationState: SynchronizationState { return mockApplicationStatus.synchronizationState }
+    var operationState: OperationState { return mockApplicationStatus.operationState }
+    var clientRegistrationDelegate: ClientRegistrationDelegate { return mockApplicationStatus.clientRegistrationDelegate }
+    var requestCancellation: ZMRequestCancellation { return mockApplicationStatus.requestCancellation }
+    var deliveryConfirmation: DeliveryConfirmationDelegate { return mockApplicationStatus.deliveryConfirmation }
+    var notificationFetchStatus: BackgroundNotificationFetchStatus { return mockApplicationStatus.notificationFetchStatus }
+    var notificationHugeFetchStatus: BackgroundNotificationFetchStatus { return .done }
+    
+    func requestSlowSync() {
+        mockApplicationStatus.requestSlowSync()
+    }
+    
 }
@@ -20,4 +20,12 @@
 
 - (ZMTransportRequest * _Nullable)nextRequestIfAllowed;
 
+/// Whether the strategy is allowed to create requests in the current state of the application status.
+/// Strategies which are not can be skipped until the word of the `ZMRequestGatingState` changes.
+@property (nonatomic, readonly) BOOL allowsRequests;
+
+/// The decision is cached until the state of the application status changes, subclasses changing
+/// their configuration have to call this.
+- (void)invalidateRequestGatingDecision;
+
 @end
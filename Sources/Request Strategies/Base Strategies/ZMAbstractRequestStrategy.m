@@ -7,6 +7,16 @@
 
 static NSString* ZMLogTag ZM_UNUSED = @"Request Configuration";
 
+@interface ZMAbstractRequestStrategy ()
+{
+    ZMRequestGatingState *_gatingState;
+    /// Word of the gating state the last decision was made for, NSUIntegerMax is never published
+    NSUInteger _gatingWord;
+    BOOL _isAllowed;
+}
+
+@end
+
 @implementation ZMAbstractRequestStrategy
 
 - (instancetype)initWithManagedObjectContext:(NSManagedObjectContext *)managedObjectContext applicationStatus:(id<ZMApplicationStatus>)applicationStatus
@@ -16,6 +26,10 @@ static NSString* ZMLogTag ZM_UNUSED = @"Request Configuration";
     if (self != nil) {
         _managedObjectContext = managedObjectContext;
         _applicationStatus = applicationStatus;
+        _gatingWord = NSUIntegerMax;
+        if ([applicationStatus respondsToSelector:@selector(requestGatingState)]) {
+            _gatingState = applicationStatus.requestGatingState;
+        }
     }
     
     return self;
@@ -28,13 +42,55 @@ static NSString* ZMLogTag ZM_UNUSED = @"Request Configuration";
     return nil;
 }
 
+- (BOOL)allowsRequests
+{
+    // A status which goes away invalidates its gating state, which then doesn't allow requests
+    if (_gatingState != nil) {
+        NSUInteger word = _gatingState.word;
+        if (word != _gatingWord && _gatingState.isInvalidated) {
+            // Only the known options are compared with the configuration, which would let a strategy allowing all of them through
+            _gatingWord = word;
+            _isAllowed = NO;
+        } else if (word != _gatingWord) {
+            [self updateGatingDecisionWithPrerequisites:_gatingState.prerequisites word:word];
+        }
+        return _isAllowed;
+    }
+    
+    // The status doesn't publish its state, read it on each call
+    if (self.applicationStatus == nil) {
+        ZMLogError(@"applicationStatus is missing");
+        return NO;
+    }
+    ZMStrategyConfigurationOption prerequisites = [AbstractRequestStrategy prerequisitesForApplicationStatus:self.applicationStatus];
+    if (prerequisites != _gatingWord) {
+        [self updateGatingDecisionWithPrerequisites:prerequisites word:prerequisites];
+    }
+    return _isAllowed;
+}
+
 - (ZMTransportRequest *)nextRequest
 {
-    if ([self configuration:self.configuration isSubsetOfPrerequisites:[AbstractRequestStrategy prerequisitesForApplicationStatus:self.applicationStatus]]) {
-        return [self nextRequestIfAllowed];
+    if (!self.allowsRequests) {
+        return nil;
     }
     
-    return nil;
+    ZMTransportRequest *request = [self nextRequestIfAllowed];
+    if (request != nil && ZMSessionRecorder.sharedRecorder.isRecording) {
+        [ZMSessionRecorder.sharedRecorder recordResponseToRequest:request groupQueue:self.managedObjectContext];
+    }
+    return request;
+}
+
+- (void)updateGatingDecisionWithPrerequisites:(ZMStrategyConfigurationOption)prerequisites word:(NSUInteger)word
+{
+    _gatingWord = word;
+    _isAllowed = [self configuration:self.configuration isSubsetOfPrerequisites:prerequisites];
+}
+
+- (void)invalidateRequestGatingDecision
+{
+    _gatingWord = NSUIntegerMax;
 }
 
 - (BOOL)configuration:(ZMStrategyConfigurationOption)configuration isSubsetOfPrerequisites:(ZMStrategyConfigurationOption)prerequisites
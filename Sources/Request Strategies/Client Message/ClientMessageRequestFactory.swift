@@ -12,6 +12,14 @@ public final class ClientMessageRequestFactory: NSObject {
     
     let protobufContentType = "application/x-protobuf"
     let octetStreamContentType = "application/octet-stream"
+    let jsonContentType = "application/json"
+    
+    /// Serialized payloads of messages sent to huge groups, by message nonce
+    fileprivate let encodedHugeGroupPayloads: NSCache<NSUUID, NSData> = {
+        let cache = NSCache<NSUUID, NSData>()
+        cache.countLimit = 200
+        return cache
+    }()
     
     public func upstreamRequestForFetchingClients(conversationId: UUID, selfClient: UserClient) -> ZMTransportRequest? {
         let originalPath = "/" + ["conversations", conversationId.transportString(), "otr", "messages"].joined(separator: "/")
@@ -48,16 +56,39 @@ public final class ClientMessageRequestFactory: NSObject {
 
     public func upstreamRequestForUnencryptedClientMessage(_ message: UnencryptedMessagePayloadGenerator, forConversationWithId conversationId: UUID) -> ZMTransportRequest? {
         let originalPath =  "/" + ["conversations", conversationId.transportString(), "bgp", "messages"].joined(separator: "/")
-        guard let payload = message.unencryptedMessagePayload() else {
+        guard let body = encodedUnencryptedMessagePayload(for: message) else {
             return nil
         }
         let path = originalPath.pathWithMissingClientStrategy(strategy: .doNotIgnoreAnyMissingClient)
-        let request = ZMTransportRequest(path: path, method: .methodPOST, payload: payload as ZMTransportData)
+        let request = ZMTransportRequest(path: path, method: .methodPOST, binaryData: body, type: jsonContentType, contentDisposition: nil)
         request.addContentDebugInformation(message.unencryptedMessageDebugInfo)
         request.priorityLevel = .highLevel
         return request
     }
     
+    /// Returns the serialized payload of a message sent to a huge group.
+    /// The payload is only encoded once per message, retries reuse the serialized bytes.
+    fileprivate func encodedUnencryptedMessagePayload(for message: UnencryptedMessagePayloadGenerator) -> Data? {
+        let nonce = (message as? ZMMessage)?.nonce.map { $0 as NSUUID }
+        if let nonce = nonce, let encoded = encodedHugeGroupPayloads.object(forKey: nonce) {
+            return encoded as Data
+        }
+        guard
+            let payload = message.unencryptedMessagePayload(),
+            let encoded = try? JSONSerialization.data(withJSONObject: payload, options: []) else {
+                return nil
+        }
+        if let nonce = nonce {
+            encodedHugeGroupPayloads.setObject(encoded as NSData, forKey: nonce)
+        }
+        return encoded
+    }
+    
+    /// Drops the serialized huge group payload of a message once it doesn't need to be sent anymore
+    public func discardEncodedPayload(forMessageWithNonce nonce: UUID) {
+        encodedHugeGroupPayloads.removeObject(forKey: nonce as NSUUID)
+    }
+    
     public func requestToGetAsset(_ assetId: String, inConversation conversationId: UUID) -> ZMTransportRequest {
         let path = "/" + ["conversations", conversationId.transportString(), "otr", "assets", assetId].joined(separator: "/")
         let request = ZMTransportRequest.imageGet(fromPath: path)
@@ -39,6 +39,35 @@ extension ClientMessageRequestFactoryTests {
     }
 }
 
+// MARK: - Huge group messages
+extension ClientMessageRequestFactoryTests {
+    
+    func testThatItCreatesRequestToPostHugeGroupMessageOnlyEncodingItOnce() {
+        
+        self.syncMOC.performGroupedBlockAndWait {
+            
+            // GIVEN
+            self.groupConversation.conversationType = .hugeGroup
+            let message = self.groupConversation.append(text: "Antani") as! ZMClientMessage
+            let sut = ClientMessageRequestFactory()
+            
+            // WHEN
+            guard
+                let request = sut.upstreamRequestForMessage(message),
+                let retriedRequest = sut.upstreamRequestForMessage(message) else {
+                    return XCTFail("No request")
+            }
+            
+            // THEN
+            XCTAssertEqual(request.method, ZMTransportRequestMethod.methodPOST)
+            XCTAssertEqual(request.path, "/conversations/\(self.groupConversation.remoteIdentifier!.transportString())/bgp/messages")
+            XCTAssertEqual(request.binaryDataType, "application/json")
+            XCTAssertNotNil(request.binaryData)
+            XCTAssertTrue(request.binaryData == retriedRequest.binaryData)
+        }
+    }
+}
+
 // MARK: - Confirmation Messages
 extension ClientMessageRequestFactoryTests {
     
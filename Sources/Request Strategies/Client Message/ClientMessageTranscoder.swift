@@ -108,22 +108,27 @@ extension ClientMessageTranscoder: ZMUpstreamTranscoder {
 //            }
 //        }
 
-        let request = conversation.conversationType == .hugeGroup
+        let isHugeGroup = conversation.conversationType == .hugeGroup
+        let request = isHugeGroup
             ? requestFactory.upstreamRequestForUnencryptedClientMessage(message, forConversationWithId: cid)!
             : requestFactory.upstreamRequestForMessage(message, forConversationWithId: cid)!
         
-        // We need to flush the encrypted payloads cache, since the client is online now (request succeeded).
-        let completionHandler = ZMCompletionHandler(on: self.managedObjectContext) { response in
-            guard let selfClient = ZMUser.selfUser(in: self.managedObjectContext).selfClient(),
-                    response.result == .success else {
-                return
-            }
-            selfClient.keysStore.encryptionContext.perform { (session) in
-                session.purgeEncryptedPayloadCache()
+        // Huge group messages are not encrypted, so there is no encrypted payloads cache to flush
+        // and a burst of sends doesn't lock the encryption context once per message.
+        if !isHugeGroup {
+            // We need to flush the encrypted payloads cache, since the client is online now (request succeeded).
+            let completionHandler = ZMCompletionHandler(on: self.managedObjectContext) { response in
+                guard let selfClient = ZMUser.selfUser(in: self.managedObjectContext).selfClient(),
+                        response.result == .success else {
+                    return
+                }
+                selfClient.keysStore.encryptionContext.perform { (session) in
+                    session.purgeEncryptedPayloadCache()
+                }
             }
+            
+            request.add(completionHandler)
         }
-        
-        request.add(completionHandler)
 
         self.messageExpirationTimer.stop(for: message)
         if let expiration = message.expirationDate {
@@ -134,6 +139,9 @@ extension ClientMessageTranscoder: ZMUpstreamTranscoder {
     
     public func requestExpired(for managedObject: ZMManagedObject, forKeys keys: Set<String>) {
         guard let message = managedObject as? ZMOTRMessage else { return }
+        if let nonce = message.nonce {
+            requestFactory.discardEncodedPayload(forMessageWithNonce: nonce)
+        }
         message.expire()
         self.localNotificationDispatcher?.didFailToSend(message)
     }
@@ -151,38 +159,85 @@ extension ClientMessageTranscoder {
     }
     
     func insertMessage(from event: ZMUpdateEvent, prefetchResult: ZMFetchRequestBatchResult?) {
-        switch event.type {
-        case .conversationClientMessageAdd,
-             .conversationOtrMessageAdd,
-             .conversationOtrAssetAdd,
-             .conversationServiceMessageAdd,
-             .conversationJsonMessageAdd,
-             .conversationMemberJoinask,
-             .conversationBgpMessageAdd:
-            
-            // process generic message first, b/c if there is no updateResult, then
-            // a the event from a deleted message wouldn't delete the notification.
-            if event.source == .pushNotification || event.source == .webSocket {
-                if let genericMessage = ZMGenericMessage(from: event) {
-                    self.localNotificationDispatcher?.process(genericMessage)
+        insertMessages(from: [event], prefetchResult: prefetchResult)
+    }
+    
+    /// Inserts the messages contained in a batch of events.
+    /// Conversations and messages are resolved from the prefetch result, the messages are created
+    /// without intermediate change processing and `processPendingChanges` runs once at the end.
+    func insertMessages(from events: [ZMUpdateEvent], prefetchResult: ZMFetchRequestBatchResult?) {
+        let messageEvents = events.filter { ClientMessageTranscoder.insertableEventTypes.contains($0.type) }
+        guard !messageEvents.isEmpty else { return }
+        
+        // process generic messages first, b/c if there is no updateResult, then
+        // a the event from a deleted message wouldn't delete the notification.
+        let notifiableEvents = messageEvents.filter { $0.source == .pushNotification || $0.source == .webSocket }
+        notifiableEvents.compactMap { ZMGenericMessage(from: $0) }.forEach {
+            self.localNotificationDispatcher?.process($0)
+        }
+        
+        var notifiableMessages: [ZMMessage] = []
+        var insertedNonces = Set<UUID>()
+        
+        for event in ClientMessageTranscoder.groupedByConversation(messageEvents) {
+            if let nonce = event.messageNonce() {
+                // A second event for the same nonce has to see the result of the first one
+                if insertedNonces.contains(nonce) {
+                    managedObjectContext.processPendingChanges()
                 }
+                insertedNonces.insert(nonce)
             }
             
-            guard let message = ZMOTRMessage.createOrUpdate(from: event, in: managedObjectContext, prefetchResult: prefetchResult) else { return }
+            guard let message = ZMOTRMessage.createOrUpdate(from: event, in: managedObjectContext, prefetchResult: prefetchResult) else { continue }
             
             message.markAsSent()
             
             if event.source == .pushNotification || event.source == .webSocket {
-                self.localNotificationDispatcher?.process(message)
+                notifiableMessages.append(message)
             }
-            
-        default:
-            break
         }
         
         managedObjectContext.processPendingChanges()
+        
+        guard !notifiableMessages.isEmpty, let dispatcher = self.localNotificationDispatcher else { return }
+        if dispatcher.responds(to: #selector(PushMessageHandler.process(messages:))) {
+            dispatcher.process?(messages: notifiableMessages)
+        } else {
+            notifiableMessages.forEach { dispatcher.process($0) }
+        }
     }
     
+    /// Orders the events by conversation, keeping the order of the events within each conversation
+    /// and the order in which the conversations first appear in the batch.
+    static func groupedByConversation(_ events: [ZMUpdateEvent]) -> [ZMUpdateEvent] {
+        var conversationOrder: [UUID] = []
+        var eventsByConversation: [UUID: [ZMUpdateEvent]] = [:]
+        var eventsWithoutConversation: [ZMUpdateEvent] = []
+        
+        for event in events {
+            guard let conversationID = event.conversationUUID() else {
+                eventsWithoutConversation.append(event)
+                continue
+            }
+            if eventsByConversation[conversationID] == nil {
+                conversationOrder.append(conversationID)
+            }
+            eventsByConversation[conversationID, default: []].append(event)
+        }
+        
+        return conversationOrder.flatMap { eventsByConversation[$0]! } + eventsWithoutConversation
+    }
+    
+    static let insertableEventTypes: Set<ZMUpdateEventType> = [
+        .conversationClientMessageAdd,
+        .conversationOtrMessageAdd,
+        .conversationOtrAssetAdd,
+        .conversationServiceMessageAdd,
+        .conversationJsonMessageAdd,
+        .conversationMemberJoinask,
+        .conversationBgpMessageAdd
+    ]
+    
     fileprivate func deleteOldEphemeralMessages() {
         self.managedObjectContext.performGroupedBlock { [weak self] in
             guard let `self` = self else { return }
@@ -199,6 +254,9 @@ extension ClientMessageTranscoder {
                 return
         }
 
+        if let nonce = message.nonce {
+            requestFactory.discardEncodedPayload(forMessageWithNonce: nonce)
+        }
         self.update(message, from: response, keys: upstreamRequest.keys ?? Set())
         _ = message.parseMissingClientsResponse(response, clientRegistrationDelegate: self.applicationStatus!.clientRegistrationDelegate)
         
@@ -305,7 +363,7 @@ extension ClientMessageTranscoder {
 extension ClientMessageTranscoder : ZMEventConsumer {
     
     public func processEvents(_ events: [ZMUpdateEvent], liveEvents: Bool, prefetchResult: ZMFetchRequestBatchResult?) {
-        events.forEach { _ = self.insertMessage(from: $0, prefetchResult: prefetchResult) }
+        insertMessages(from: events, prefetchResult: prefetchResult)
     }    
     
     public func messageNoncesToPrefetch(toProcessEvents events: [ZMUpdateEvent]) -> Set<UUID> {
@@ -322,6 +380,13 @@ extension ClientMessageTranscoder : ZMEventConsumer {
         })
     }
     
+    public func conversationRemoteIdentifiersToPrefetch(toProcessEvents events: [ZMUpdateEvent]) -> Set<UUID> {
+        return Set(events.compactMap {
+            guard ClientMessageTranscoder.insertableEventTypes.contains($0.type) else { return nil }
+            return $0.conversationUUID()
+        })
+    }
+    
     private func nonces(for updateEvents: [ZMUpdateEvent]) -> [UpdateEventWithNonce] {
         return updateEvents.compactMap {
             switch $0.type {
@@ -0,0 +1,42 @@
+//
+
+import XCTest
+@testable import WireRequestStrategy
+
+extension ClientMessageTranscoderTests {
+
+    func testThatItReplaysASessionSendingAMessage() {
+        // GIVEN
+        var path = ""
+        self.syncMOC.performGroupedBlockAndWait {
+            path = "/conversations/\(self.groupConversation.remoteIdentifier!.transportString())/otr/messages"
+        }
+        let response = SessionTrace.RecordedResponse(method: .methodPOST,
+                                                     path: path,
+                                                     httpStatus: 201,
+                                                     payload: ["time": Date().transportString()] as NSDictionary,
+                                                     latency: 0.2)
+        let trace = SessionTrace(steps: [.localChange("send message")], responses: [response])
+        let harness = SessionReplayHarness(context: self.syncMOC,
+                                           strategies: [self.sut],
+                                           transport: ReplayTransport(responses: trace.responses),
+                                           waitForAllGroupsToBeEmpty: { self.waitForAllGroupsToBeEmpty(withTimeout: 0.5) })
+        var message: ZMClientMessage?
+        harness.localChanges["send message"] = { _ in
+            message = self.groupConversation.append(text: "Lorem ipsum") as? ZMClientMessage
+        }
+
+        // WHEN
+        let report = harness.replay(trace)
+
+        // THEN
+        XCTAssertEqual(report.requestsIssued, 1)
+        XCTAssertEqual(report.requestsByPath["POST /conversations/{id}/otr/messages"], 1)
+        XCTAssertEqual(report.unmatchedRequests, 0)
+        XCTAssertEqual(report.simulatedDrainTime, 0.2, accuracy: 0.001)
+        XCTAssertFalse(report.reachedRequestLimit)
+        self.syncMOC.performGroupedBlockAndWait {
+            XCTAssertEqual(message?.deliveryState, .sent)
+        }
+    }
+}
@@ -89,6 +89,77 @@ extension ClientMessageTranscoderTests {
         }
     }
     
+    func testThatItInsertsAllMessagesOfABatch() {
+        self.syncMOC.performGroupedBlockAndWait {
+            
+            // GIVEN
+            let groupEvent1 = self.decryptedUpdateEventFromOtherClient(text: "1")
+            let oneToOneEvent = self.decryptedUpdateEventFromOtherClient(text: "2", conversation: self.oneToOneConversation)
+            let groupEvent2 = self.decryptedUpdateEventFromOtherClient(text: "3")
+            
+            // WHEN
+            self.sut.processEvents([groupEvent1, oneToOneEvent, groupEvent2], liveEvents: false, prefetchResult: nil)
+            
+            // THEN
+            XCTAssertEqual((self.groupConversation.lastMessage as? ZMClientMessage)?.textMessageData?.messageText, "3")
+            XCTAssertEqual((self.oneToOneConversation.lastMessage as? ZMClientMessage)?.textMessageData?.messageText, "2")
+            XCTAssertEqual(self.localNotificationDispatcher.processedGenericMessages.count, 3)
+            XCTAssertEqual(self.localNotificationDispatcher.processedMessages.count, 3)
+        }
+    }
+    
+    func testThatItKeepsTheOrderOfEventsWithinAConversation() {
+        
+        // GIVEN
+        let events = self.syncMOC.performGroupedAndWait { _ in
+            return [
+                self.decryptedUpdateEventFromOtherClient(text: "1"),
+                self.decryptedUpdateEventFromOtherClient(text: "2", conversation: self.oneToOneConversation),
+                self.decryptedUpdateEventFromOtherClient(text: "3"),
+            ]
+        }
+        
+        // WHEN
+        let grouped = ClientMessageTranscoder.groupedByConversation(events)
+        
+        // THEN
+        XCTAssertEqual(grouped.map { $0.uuid }, [events[0], events[2], events[1]].map { $0.uuid })
+    }
+    
+    func testThatItRegistersTheConversationsOfTheEventsForPrefetching() {
+        self.syncMOC.performGroupedBlockAndWait {
+            
+            // GIVEN
+            let events = [self.decryptedUpdateEventFromOtherClient(text: "1"),
+                          self.decryptedUpdateEventFromOtherClient(text: "2", conversation: self.oneToOneConversation)]
+            
+            // WHEN
+            let identifiers = self.sut.conversationRemoteIdentifiersToPrefetch(toProcessEvents: events)
+            
+            // THEN
+            XCTAssertEqual(identifiers, Set([self.groupConversation.remoteIdentifier!, self.oneToOneConversation.remoteIdentifier!]))
+        }
+    }
+    
+    func testThatItDispatchesNotificationsForABatchAtOnce() {
+        self.syncMOC.performGroupedBlockAndWait {
+            
+            // GIVEN
+            let batchDispatcher = MockBatchPushMessageHandler()
+            self.sut = ClientMessageTranscoder(in: self.syncMOC, localNotificationDispatcher: batchDispatcher, applicationStatus: self.mockApplicationStatus)
+            let events = [self.decryptedUpdateEventFromOtherClient(text: "1"),
+                          self.decryptedUpdateEventFromOtherClient(text: "2")]
+            
+            // WHEN
+            self.sut.processEvents(events, liveEvents: true, prefetchResult: nil)
+            
+            // THEN
+            XCTAssertEqual(batchDispatcher.processedBatches.count, 1)
+            XCTAssertEqual(batchDispatcher.processedBatches.first?.count, 2)
+            XCTAssertTrue(batchDispatcher.processedMessages.isEmpty)
+        }
+    }
+    
 }
 
 // MARK: - Request generation
@@ -315,3 +386,15 @@ extension ClientMessageTranscoderTests {
         }
     }
 }
+
+// MARK: - Helpers
+
+private class MockBatchPushMessageHandler: MockPushMessageHandler {
+    
+    fileprivate(set) var processedBatches: [[ZMMessage]] = []
+    
+    @objc(processMessages:)
+    func process(messages: [ZMMessage]) {
+        processedBatches.append(messages)
+    }
+}
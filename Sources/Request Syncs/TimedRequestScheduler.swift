@@ -0,0 +1,230 @@
+//
+
+import Foundation
+import UIKit
+import WireSystem
+
+/// Wakes up the scheduler when its next timer is due
+protocol TimedRequestSchedulerTimerSource: AnyObject {
+    func setEventHandler(_ handler: @escaping () -> Void)
+    /// Fires after the delay, or at most `leeway` later. A `nil` delay stops it from firing
+    func schedule(after delay: TimeInterval?, leeway: TimeInterval)
+    func cancel()
+}
+
+/// Timer source backed by a dispatch timer, firing on its own queue
+final class DispatchTimedRequestSchedulerTimerSource: TimedRequestSchedulerTimerSource {
+
+    private let timer = DispatchSource.makeTimerSource(queue: DispatchQueue(label: "ZMTimedRequestScheduler.timer"))
+
+    init() {
+        timer.schedule(deadline: .distantFuture)
+        timer.resume()
+    }
+
+    func setEventHandler(_ handler: @escaping () -> Void) {
+        timer.setEventHandler(handler: handler)
+    }
+
+    func schedule(after delay: TimeInterval?, leeway: TimeInterval) {
+        guard let delay = delay else {
+            timer.schedule(deadline: .distantFuture)
+            return
+        }
+        timer.schedule(deadline: .now() + delay, leeway: .nanoseconds(Int(leeway * Double(NSEC_PER_SEC))))
+    }
+
+    func cancel() {
+        timer.cancel()
+    }
+}
+
+/// Fires the timers of the timed request syncs from a single queue and timer source.
+///
+/// Each timer gets a tolerance proportional to its interval. When the timer source fires, all timers
+/// due within their tolerance fire together, so that periodic syncs wake the process up once instead of
+/// each on their own schedule. Timers scheduled with `suspendsInBackground` don't fire while the app is
+/// in the background; those which became due in the meantime fire together once it returns to the foreground.
+@objc(ZMTimedRequestScheduler)
+public final class TimedRequestScheduler: NSObject {
+
+    private struct ScheduledTimer {
+        weak var owner: AnyObject?
+        let fireDate: Date
+        let tolerance: TimeInterval
+        /// Entered while the timer is pending, left while it is held back in the background
+        let group: ZMSDispatchGroup?
+        let suspendsInBackground: Bool
+        let handler: () -> Void
+    }
+
+    @objc(sharedScheduler)
+    public static let shared = TimedRequestScheduler()
+
+    /// Fraction of its interval by which a timer can fire early to fire together with others
+    public var toleranceRatio: Double = 0.1
+
+    /// Upper bound of the tolerance of a timer
+    public var maximumTolerance: TimeInterval = 5
+
+    private let queue = DispatchQueue(label: "ZMTimedRequestScheduler")
+    private let timerSource: TimedRequestSchedulerTimerSource
+    private var timers: [ObjectIdentifier: ScheduledTimer] = [:]
+    private var isSuspended = false
+    private let currentDate: () -> Date
+    private let notificationCenter: NotificationCenter
+    private var observers: [NSObjectProtocol] = []
+    /// Runs the handler of a timer which fired
+    private let performHandler: (@escaping () -> Void) -> Void
+
+    init(notificationCenter: NotificationCenter = .default,
+         currentDate: @escaping () -> Date = Date.init,
+         timerSource: TimedRequestSchedulerTimerSource = DispatchTimedRequestSchedulerTimerSource(),
+         performHandler: @escaping (@escaping () -> Void) -> Void = { DispatchQueue.global(qos: .utility).async(execute: $0) }) {
+        self.currentDate = currentDate
+        self.notificationCenter = notificationCenter
+        self.timerSource = timerSource
+        self.performHandler = performHandler
+        super.init()
+
+        timerSource.setEventHandler { [weak self] in
+            guard let `self` = self else { return }
+            self.queue.sync { self.fireDueTimers() }
+        }
+
+        observers = [
+            notificationCenter.addObserver(forName: UIApplication.didEnterBackgroundNotification, object: nil, queue: nil) { [weak self] _ in
+                self?.suspend()
+            },
+            notificationCenter.addObserver(forName: UIApplication.willEnterForegroundNotification, object: nil, queue: nil) { [weak self] _ in
+                self?.resume()
+            }
+        ]
+    }
+
+    deinit {
+        observers.forEach(notificationCenter.removeObserver)
+        timerSource.cancel()
+    }
+
+    // MARK: - Timers
+
+    /// Calls the handler on a background queue once the interval has elapsed, replacing the timer the owner had before
+    @objc(scheduleForOwner:after:handler:)
+    public func schedule(for owner: AnyObject, after interval: TimeInterval, handler: @escaping () -> Void) {
+        schedule(for: owner, after: interval, group: nil, suspendsInBackground: false, handler: handler)
+    }
+
+    /// Calls the handler on a background queue once the interval has elapsed, replacing the timer the owner had before.
+    /// The group is entered until the handler ran or the timer is cancelled, except while the timer is held back in the background.
+    @objc(scheduleForOwner:after:group:suspendsInBackground:handler:)
+    public func schedule(for owner: AnyObject, after interval: TimeInterval, group: ZMSDispatchGroup?, suspendsInBackground: Bool, handler: @escaping () -> Void) {
+        let tolerance = min(maximumTolerance, interval * toleranceRatio)
+        let timer = ScheduledTimer(owner: owner,
+                                   fireDate: currentDate().addingTimeInterval(interval),
+                                   tolerance: tolerance,
+                                   group: group,
+                                   suspendsInBackground: suspendsInBackground,
+                                   handler: handler)
+        queue.sync {
+            // The identifier of an owner that went away can be reused by the new one
+            fireOrphanedTimers()
+            if let previous = timers.updateValue(timer, forKey: ObjectIdentifier(owner)), isHoldingGroup(previous) {
+                previous.group?.leave()
+            }
+            if isHoldingGroup(timer) {
+                group?.enter()
+            }
+            rescheduleTimerSource()
+        }
+    }
+
+    /// Cancels the timer of the owner. Returns `true` if there was a timer which didn't fire yet
+    @objc(cancelForOwner:)
+    @discardableResult
+    public func cancel(for owner: AnyObject) -> Bool {
+        return queue.sync {
+            guard let timer = timers.removeValue(forKey: ObjectIdentifier(owner)) else { return false }
+            if isHoldingGroup(timer) {
+                timer.group?.leave()
+            }
+            rescheduleTimerSource()
+            return true
+        }
+    }
+
+    /// The date at which the timer of the owner is due, `nil` if it has none
+    @objc(nextFireDateForOwner:)
+    public func nextFireDate(for owner: AnyObject) -> Date? {
+        return queue.sync {
+            timers[ObjectIdentifier(owner)]?.fireDate
+        }
+    }
+
+    // MARK: - Suspension
+
+    /// Stops firing the timers which suspend in the background until `resume()` is called.
+    /// Their groups are left, so that waiting for a group doesn't wait for the app to return to the foreground.
+    @objc public func suspend() {
+        queue.sync {
+            guard !isSuspended else { return }
+            timers.values.filter { $0.suspendsInBackground }.forEach { $0.group?.leave() }
+            isSuspended = true
+            rescheduleTimerSource()
+        }
+    }
+
+    /// Fires the timers which became due while suspended and resumes firing timers
+    @objc public func resume() {
+        queue.sync {
+            guard isSuspended else { return }
+            isSuspended = false
+            timers.values.filter { $0.suspendsInBackground }.forEach { $0.group?.enter() }
+            rescheduleTimerSource()
+        }
+    }
+
+    // MARK: - Helpers
+
+    /// Whether the group of the timer is entered, it isn't while the timer is held back in the background
+    private func isHoldingGroup(_ timer: ScheduledTimer) -> Bool {
+        return !(isSuspended && timer.suspendsInBackground)
+    }
+
+    /// Runs the handler of a timer which was removed, then leaves its group
+    private func fire(_ timer: ScheduledTimer) {
+        let group = isHoldingGroup(timer) ? timer.group : nil
+        performHandler {
+            timer.handler()
+            group?.leave()
+        }
+    }
+
+    /// Timers of owners that went away without cancelling them fire right away, so that their handlers can clean up
+    private func fireOrphanedTimers() {
+        let orphanedTimers = timers.filter { $0.value.owner == nil }
+        orphanedTimers.keys.forEach { timers.removeValue(forKey: $0) }
+        orphanedTimers.values.forEach(fire)
+    }
+
+    private func rescheduleTimerSource() {
+        fireOrphanedTimers()
+
+        let activeTimers = timers.values.filter { !isSuspended || !$0.suspendsInBackground }
+        guard let next = activeTimers.min(by: { $0.fireDate < $1.fireDate }) else {
+            timerSource.schedule(after: nil, leeway: 0)
+            return
+        }
+
+        let delay = max(0, next.fireDate.timeIntervalSince(currentDate()))
+        timerSource.schedule(after: delay, leeway: next.tolerance)
+    }
+
+    private func fireDueTimers() {
+        let now = currentDate()
+        let dueTimers = timers.filter { $0.value.fireDate.timeIntervalSince(now) <= $0.value.tolerance && isHoldingGroup($0.value) }
+        dueTimers.keys.forEach { timers.removeValue(forKey: $0) }
+        rescheduleTimerSource()
+        dueTimers.values.forEach(fire)
+    }
+}
@@ -0,0 +1,231 @@
+//
+
+import XCTest
+import WireSystem
+@testable import WireRequestStrategy
+
+/// Fires when the test clock reaches the date it was scheduled for, see `TimedRequestSchedulerTests.advanceClock(by:)`
+private final class ManualTimerSource: TimedRequestSchedulerTimerSource {
+
+    private let currentDate: () -> Date
+    private var handler: (() -> Void)?
+    private(set) var fireDate: Date?
+    private(set) var leeway: TimeInterval = 0
+
+    init(currentDate: @escaping () -> Date) {
+        self.currentDate = currentDate
+    }
+
+    func setEventHandler(_ handler: @escaping () -> Void) {
+        self.handler = handler
+    }
+
+    func schedule(after delay: TimeInterval?, leeway: TimeInterval) {
+        fireDate = delay.map(currentDate().addingTimeInterval)
+        self.leeway = leeway
+    }
+
+    func cancel() {
+        fireDate = nil
+    }
+
+    func fire() {
+        fireDate = nil
+        handler?()
+    }
+}
+
+/// Counts how often it is entered and not left yet
+private final class CountingDispatchGroup: ZMSDispatchGroup {
+
+    private(set) var enteredCount = 0
+
+    override func enter() {
+        enteredCount += 1
+        super.enter()
+    }
+
+    override func leave() {
+        enteredCount -= 1
+        super.leave()
+    }
+}
+
+class TimedRequestSchedulerTests: XCTestCase {
+
+    var notificationCenter: NotificationCenter!
+    var now: Date!
+    fileprivate var timerSource: ManualTimerSource!
+    var pendingHandlers: [() -> Void] = []
+    var sut: TimedRequestScheduler!
+
+    override func setUp() {
+        super.setUp()
+        notificationCenter = NotificationCenter()
+        now = Date()
+        timerSource = ManualTimerSource(currentDate: { [unowned self] in self.now })
+        sut = TimedRequestScheduler(notificationCenter: notificationCenter,
+                                    currentDate: { [unowned self] in self.now },
+                                    timerSource: timerSource,
+                                    performHandler: { [unowned self] in self.pendingHandlers.append($0) })
+    }
+
+    override func tearDown() {
+        sut = nil
+        timerSource = nil
+        pendingHandlers = []
+        now = nil
+        notificationCenter = nil
+        super.tearDown()
+    }
+
+    /// Advances the clock, fires the timer source if it is due and runs the handlers of the timers which fired
+    func advanceClock(by interval: TimeInterval) {
+        now = now.addingTimeInterval(interval)
+        if let fireDate = timerSource.fireDate, fireDate <= now {
+            timerSource.fire()
+        }
+        let handlers = pendingHandlers
+        pendingHandlers = []
+        handlers.forEach { $0() }
+    }
+
+    func testThatItFiresTheTimerAfterTheInterval() {
+        // given
+        let owner = NSObject()
+        var fireCount = 0
+
+        // when
+        sut.schedule(for: owner, after: 10) {
+            fireCount += 1
+        }
+        advanceClock(by: 9)
+
+        // then
+        XCTAssertEqual(fireCount, 0)
+        XCTAssertNotNil(sut.nextFireDate(for: owner))
+
+        // when
+        advanceClock(by: 1)
+
+        // then
+        XCTAssertEqual(fireCount, 1)
+        XCTAssertNil(sut.nextFireDate(for: owner))
+    }
+
+    func testThatItDoesNotFireACancelledTimer() {
+        // given
+        let owner = NSObject()
+        var fireCount = 0
+        sut.schedule(for: owner, after: 10) {
+            fireCount += 1
+        }
+
+        // when
+        let cancelled = sut.cancel(for: owner)
+
+        // then
+        XCTAssertTrue(cancelled)
+        XCTAssertFalse(sut.cancel(for: owner))
+        XCTAssertNil(timerSource.fireDate)
+        timerSource.fire()
+        advanceClock(by: 10)
+        XCTAssertEqual(fireCount, 0)
+    }
+
+    func testThatItFiresTimersDueWithinTheToleranceTogether() {
+        // given
+        let (first, second, third) = (NSObject(), NSObject(), NSObject())
+        var fired: [String] = []
+
+        // when
+        sut.schedule(for: first, after: 10) { fired.append("first") }
+        sut.schedule(for: second, after: 10.5) { fired.append("second") }
+        sut.schedule(for: third, after: 20) { fired.append("third") }
+        XCTAssertEqual(timerSource.leeway, 1, accuracy: 0.001)
+        advanceClock(by: 10)
+
+        // then
+        XCTAssertEqual(Set(fired), ["first", "second"])
+        XCTAssertEqual(timerSource.fireDate, now.addingTimeInterval(10))
+    }
+
+    func testThatItDoesNotFireWhileSuspendedAndCatchesUpWhenResumed() {
+        // given
+        let owner = NSObject()
+        var fireCount = 0
+        notificationCenter.post(name: UIApplication.didEnterBackgroundNotification, object: nil)
+        sut.schedule(for: owner, after: 1, group: nil, suspendsInBackground: true) {
+            fireCount += 1
+        }
+
+        // when
+        advanceClock(by: 5)
+
+        // then
+        XCTAssertNil(timerSource.fireDate)
+        XCTAssertEqual(fireCount, 0)
+
+        // when
+        notificationCenter.post(name: UIApplication.willEnterForegroundNotification, object: nil)
+        advanceClock(by: 0)
+
+        // then
+        XCTAssertEqual(fireCount, 1)
+    }
+
+    func testThatItFiresTimersWhichDoNotSuspendWhileInTheBackground() {
+        // given
+        let owner = NSObject()
+        var fireCount = 0
+        sut.schedule(for: owner, after: 1) {
+            fireCount += 1
+        }
+
+        // when
+        notificationCenter.post(name: UIApplication.didEnterBackgroundNotification, object: nil)
+        advanceClock(by: 1)
+
+        // then
+        XCTAssertEqual(fireCount, 1)
+    }
+
+    func testThatItLeavesTheGroupWhileTheTimerIsSuspended() {
+        // given
+        let owner = NSObject()
+        let group = CountingDispatchGroup(label: "TimedRequestSchedulerTests")
+        sut.schedule(for: owner, after: 10, group: group, suspendsInBackground: true) {}
+        XCTAssertEqual(group.enteredCount, 1)
+
+        // when
+        notificationCenter.post(name: UIApplication.didEnterBackgroundNotification, object: nil)
+
+        // then
+        XCTAssertEqual(group.enteredCount, 0)
+
+        // when
+        notificationCenter.post(name: UIApplication.willEnterForegroundNotification, object: nil)
+
+        // then
+        XCTAssertEqual(group.enteredCount, 1)
+
+        // when
+        advanceClock(by: 10)
+
+        // then
+        XCTAssertEqual(group.enteredCount, 0)
+    }
+
+    func testThatItLeavesTheGroupWhenTheTimerIsCancelled() {
+        // given
+        let owner = NSObject()
+        let group = CountingDispatchGroup(label: "TimedRequestSchedulerTests")
+        sut.schedule(for: owner, after: 10, group: group, suspendsInBackground: false) {}
+
+        // when
+        sut.cancel(for: owner)
+
+        // then
+        XCTAssertEqual(group.enteredCount, 0)
+    }
+}
@@ -12,6 +12,13 @@
 /// setting this stops the current timer
 @property (nonatomic) NSTimeInterval timeInterval;
 
+/// If YES, the timer doesn't fire while the app is in the background, it fires once the app returns
+/// to the foreground instead. Defaults to NO, applies from the next time the timer is started
+@property (nonatomic) BOOL suspendsInBackground;
+
+/// Date at which the next request will be available, nil if there is no timer running
+@property (nonatomic, readonly) NSDate *nextFireDate;
+
 
 - (instancetype)initWithSingleRequestTranscoder:(id<ZMSingleRequestTranscoder>)transcoder
                                      groupQueue:(id<ZMSGroupQueue>)groupQueue NS_UNAVAILABLE;
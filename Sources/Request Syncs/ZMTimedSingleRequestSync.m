@@ -8,57 +8,18 @@
 
 #import "ZMTimedSingleRequestSync.h"
 
-@class ZMTimedRequestTriggerHolder;
-
 @interface ZMTimedSingleRequestSync ()
 
 @property (nonatomic) ZMTransportRequest *internalRequest;
 @property (nonatomic) NSTimeInterval internalTimeInterval;
 @property (atomic) BOOL shouldReturnRequest;
-@property (nonatomic) ZMTimedRequestTriggerHolder *currentHolder;
-@property (nonatomic) dispatch_queue_t queue;
-@property (nonatomic) BOOL isInvalidated;
+@property (atomic) BOOL isInvalidated;
 
 - (void)timerDidExpire;
 
 @end
 
 
-@interface ZMTimedRequestTriggerHolder : NSObject
-
-@property (nonatomic, weak) ZMTimedSingleRequestSync *triggerReference;
-
-- (instancetype)initWithTimedSingleRequest:(ZMTimedSingleRequestSync *)timedSingleRequest;
-
-- (void)invalidate;
-- (void)fireTrigger;
-
-@end
-
-@implementation ZMTimedRequestTriggerHolder
-
-- (instancetype)initWithTimedSingleRequest:(ZMTimedSingleRequestSync *)timedSingleRequest;
-{
-    self = [super init];
-    if(self) {
-        self.triggerReference = timedSingleRequest;
-    }
-    return self;
-}
-
-- (void)invalidate
-{
-    self.triggerReference = nil;
-}
-
-- (void)fireTrigger
-{
-    [self.triggerReference timerDidExpire];
-}
-
-@end
-
-
 
 @implementation ZMTimedSingleRequestSync
 
@@ -70,7 +31,6 @@
     if(self) {
         self.timeInterval = timeInterval;
         self.shouldReturnRequest = YES;
-        self.queue = dispatch_queue_create("ZMTimedSingleRequestSync", DISPATCH_QUEUE_SERIAL);
         [self readyForNextRequest];
     }
     return self;
@@ -85,20 +45,11 @@
 {
     if(self.shouldReturnRequest && ( ! self.isInvalidated) ) {
         
-        [self.currentHolder invalidate];
+        [self cancelTimer];
         
         if(self.timeInterval > 0) {
-            
             self.shouldReturnRequest = NO;
-            ZMTimedRequestTriggerHolder *holder = [[ZMTimedRequestTriggerHolder alloc] initWithTimedSingleRequest:self];
-            self.currentHolder = holder;
-            
-            ZMSDispatchGroup * group = self.groupQueue.dispatchGroup;
-            [group enter];
-            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.timeInterval * NSEC_PER_SEC)), self.queue, ^{
-                [holder fireTrigger];
-                [group leave];
-            });
+            [self scheduleTimer];
         }
         
         return [super nextRequest];
@@ -106,10 +57,36 @@
     return nil;
 }
 
+- (NSDate *)nextFireDate
+{
+    return [ZMTimedRequestScheduler.sharedScheduler nextFireDateForOwner:self];
+}
+
+- (void)scheduleTimer
+{
+    ZM_WEAK(self);
+    [ZMTimedRequestScheduler.sharedScheduler scheduleForOwner:self
+                                                        after:self.timeInterval
+                                                        group:self.groupQueue.dispatchGroup
+                                         suspendsInBackground:self.suspendsInBackground
+                                                      handler:^{
+        ZM_STRONG(self);
+        [self timerDidExpire];
+    }];
+}
+
+/// Cancels the timer if it did not fire yet
+- (void)cancelTimer
+{
+    [ZMTimedRequestScheduler.sharedScheduler cancelForOwner:self];
+}
+
 - (void)timerDidExpire
 {
     [self.groupQueue performGroupedBlock:^{
-        self.currentHolder = nil;
+        if (self.isInvalidated) {
+            return;
+        }
         self.shouldReturnRequest = YES;
         [self readyForNextRequest];
         [ZMRequestAvailableNotification notifyNewRequestsAvailable:self];
@@ -118,12 +95,7 @@
 
 - (void)invalidate
 {
-    ZMSDispatchGroup * group = self.groupQueue.dispatchGroup;
-    [group enter];
-    dispatch_sync(self.queue, ^{
-        [self.currentHolder invalidate];
-    });
-    [group leave];
+    [self cancelTimer];
     self.shouldReturnRequest = NO;
     self.isInvalidated = YES;
 }
@@ -135,7 +107,7 @@
 
 - (void)setTimeInterval:(NSTimeInterval)timeInterval
 {
-    [self.currentHolder invalidate];
+    [self cancelTimer];
     self.internalTimeInterval = timeInterval;
     self.shouldReturnRequest = YES;
     [self readyForNextRequest];
@@ -259,4 +259,19 @@
     [sut invalidate];
 }
 
+- (void)testThatItReturnsTheNextFireDateWhileTheTimerIsRunning
+{
+    // given
+    ZMTimedSingleRequestSync *sut = [[ZMTimedSingleRequestSync alloc] initWithSingleRequestTranscoder:self everyTimeInterval:10 groupQueue:self.testSession.uiMOC];
+    XCTAssertNil(sut.nextFireDate);
+    
+    // when
+    [sut nextRequest];
+    
+    // then
+    XCTAssertEqualWithAccuracy(sut.nextFireDate.timeIntervalSinceNow, 10, 0.5);
+    [sut invalidate];
+    XCTAssertNil(sut.nextFireDate);
+}
+
 @end
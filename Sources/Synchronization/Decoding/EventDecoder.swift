@@ -8,6 +8,9 @@ private let zmLog = ZMSLog(tag: "EventDecoder")
 /// Key used in persistent store metadata
 private let previouslyReceivedEventIDsKey = "zm_previouslyReceivedEventIDsKey"
 
+/// Event under which the metrics of the decoder are reported
+private let metricsEvent = "event_decoder"
+
 /// Decodes and stores events from various sources to be processed later
 @objcMembers public final class EventDecoder: NSObject {
     
@@ -23,6 +26,10 @@ private let previouslyReceivedEventIDsKey = "zm_previouslyReceivedEventIDsKey"
     /// Set this for testing purposes only
     public static var testingBatchSize : Int?
     
+    private static let decryptionDuration = Metrics.shared.histogram("decryption", event: metricsEvent)
+    private static let batchProcessingDuration = Metrics.shared.histogram("batch_processing", event: metricsEvent)
+    private static let decryptedEventsCount = Metrics.shared.counter("decrypted_events", event: metricsEvent)
+    
     unowned let eventMOC : NSManagedObjectContext
     unowned let syncMOC: NSManagedObjectContext
     private let userDefault: UserDefaults?
@@ -80,7 +87,10 @@ extension EventDecoder {
             print("OriginEvents.count \(events.count)")
             let newUpdateEvents = events.compactMap { event -> ZMUpdateEvent? in
                 if event.type == .conversationOtrMessageAdd || event.type == .conversationOtrAssetAdd {
-                    return sessionsDirectory.decryptAndAddClient(event, in: self.syncMOC)
+                    EventDecoder.decryptedEventsCount.increment()
+                    return EventDecoder.decryptionDuration.measure {
+                        sessionsDirectory.decryptAndAddClient(event, in: self.syncMOC)
+                    }
                 } else {
                     return event
                 }
@@ -123,7 +133,11 @@ extension EventDecoder {
             Logging.eventProcessing.info("Forwarding \(events.count) event(s) to consumers")
         }
         
-        block(filterInvalidEvents(from: events))
+        let validEvents = filterInvalidEvents(from: events)
+        SessionRecorder.shared.record(validEvents)
+        EventDecoder.batchProcessingDuration.measure {
+            block(validEvents)
+        }
         
         if !isNewNotificationVersion {
             eventMOC.performGroupedBlockAndWait {
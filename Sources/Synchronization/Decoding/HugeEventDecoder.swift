@@ -8,13 +8,22 @@ private let zmLog = ZMSLog(tag: "HugeEventDecoder")
 /// Key used in persistent store metadata
 private let previouslyReceivedHugeEventIDsKey = "zm_previouslyReceivedHugeEventIDsKey"
 
-/// Decodes and stores events from various sources to be processed later
+/// Key used in persistent store metadata, set once the events stored as `StoredHugeUpdateEvent` have been processed
+private let hugeEventStorageKey = "zm_hugeEventStorage"
+private let hugeEventStorageLog = "log"
+
+/// Stores events of huge group conversations to be processed later.
+/// Huge group events are not encrypted and don't go through the persisted list of already received
+/// event IDs: they are appended to a `HugeEventLog`, which drops duplicates, and handed to the consumer in large batches.
 @objcMembers public final class HugeEventDecoder: NSObject {
     
     public typealias ConsumeBlock = (([ZMUpdateEvent]) -> Void)
     
     static var BatchSize : Int {
-        return 500
+        if let testingBatchSize = testingBatchSize {
+            return testingBatchSize
+        }
+        return 2000
     }
     
     /// Set this for testing purposes only
@@ -22,160 +31,118 @@ private let previouslyReceivedHugeEventIDsKey = "zm_previouslyReceivedHugeEventI
     
     unowned let eventMOC : NSManagedObjectContext
     unowned let syncMOC: NSManagedObjectContext
-    private let userDefault: UserDefaults?
+    let eventLog: HugeEventLog
+    private var hasProcessedLegacyStoredEvents = false
     
-    fileprivate typealias EventsWithStoredEvents = (storedEvents: [StoredHugeUpdateEvent], updateEvents: [ZMUpdateEvent])
+    public convenience init(eventMOC: NSManagedObjectContext, syncMOC: NSManagedObjectContext) {
+        self.init(eventMOC: eventMOC, syncMOC: syncMOC, eventLog: HugeEventLog(directory: HugeEventDecoder.eventLogDirectory(for: eventMOC)))
+    }
     
-    public init(eventMOC: NSManagedObjectContext, syncMOC: NSManagedObjectContext) {
+    init(eventMOC: NSManagedObjectContext, syncMOC: NSManagedObjectContext, eventLog: HugeEventLog) {
         self.eventMOC = eventMOC
         self.syncMOC = syncMOC
-        let groupIdentifier = UserDefaults.standard.string(forKey: EnvironmentType.groupIdentifier)
-        self.userDefault = UserDefaults(suiteName: groupIdentifier)
+        self.eventLog = eventLog
         super.init()
         self.eventMOC.performGroupedBlockAndWait {
-            self.createReceivedHugePushEventIDsStoreIfNecessary()
+            self.hasProcessedLegacyStoredEvents = self.eventMOC.persistentStoreMetadata(forKey: hugeEventStorageKey) as? String == hugeEventStorageLog
+            self.moveReceivedEventIDsToEventLog()
+        }
+    }
+    
+    /// The log is kept next to the event database, or in the temporary directory for stores without a file
+    static func eventLogDirectory(for eventMOC: NSManagedObjectContext) -> URL {
+        var storeURL: URL?
+        eventMOC.performGroupedBlockAndWait {
+            storeURL = eventMOC.persistentStoreCoordinator?.persistentStores.first?.url
+        }
+        if let storeURL = storeURL, storeURL.isFileURL, storeURL.path != "/dev/null" {
+            return storeURL.deletingLastPathComponent()
         }
+        return FileManager.default.temporaryDirectory.appendingPathComponent("HugeEvents", isDirectory: true)
     }
 }
 
 // MARK: - Process events
 extension HugeEventDecoder {
     
-    /// Decrypts passed in events and stores them in chronological order in a persisted database. It then saves the database and cryptobox
-    /// It then calls the passed in block (multiple times if necessary), returning the decrypted events
-    /// If the app crashes while processing the events, they can be recovered from the database
+    /// Appends the passed in events to the huge event log, skipping the ones that were received recently.
+    /// It then calls the passed in block (multiple times if necessary), returning the stored events
+    /// If the app crashes while processing the events, they can be recovered from the log
     public func processEvents(_ events: [ZMUpdateEvent], block: ConsumeBlock, isNewNotificationVersion: Bool = false) {
-        var lastIndex: Int64?
-        
-        eventMOC.performGroupedBlockAndWait {
-            
-            let filteredEvents = self.filterAlreadyReceivedEvents(from: events)
-            self.storeReceivedPushEventIDs(from: events)
-            
-            // Get the highest index of events in the DB
-            lastIndex = StoredHugeUpdateEvent.highestIndex(self.eventMOC)
-            
-            guard let index = lastIndex else { return }
-            self.storeEvents(filteredEvents, startingAtIndex: index)
-        }
+        let newEvents = eventLog.append(events)
         
         if !events.isEmpty {
-            Logging.eventProcessing.info("Decrypted/Stored \( events.count) event(s)")
+            Logging.eventProcessing.info("Stored \(newEvents.count) huge event(s)")
         }
         
-        process(block, firstCall: true, isNewNotificationVersion: isNewNotificationVersion)
-    }
-    
-    /// Decrypts and stores the decrypted events as `StoreUpdateEvent` in the event database.
-    /// The encryption context is only closed after the events have been stored, which ensures
-    /// they can be decrypted again in case of a crash.
-    /// - parameter events The new events that should be decrypted and stored in the database.
-    /// - parameter startingAtIndex The startIndex to be used for the incrementing sortIndex of the stored events.
-    fileprivate func storeEvents(_ events: [ZMUpdateEvent], startingAtIndex startIndex: Int64) {
-        self.eventMOC.performGroupedBlockAndWait {
-            // Insert the decryted events in the event database using a `storeIndex`
-            // incrementing from the highest index currently stored in the database
-            for (idx, event) in events.enumerated() {
-                _ = StoredHugeUpdateEvent.create(event, managedObjectContext: self.eventMOC, index: Int64(idx) + startIndex + 1)
-            }
-            
-            self.eventMOC.saveOrRollback()
+        if !isNewNotificationVersion {
+            processLegacyStoredEventsIfNeeded(block)
         }
+        process(block, firstCall: true, isNewNotificationVersion: isNewNotificationVersion)
     }
     
-    // Processes the stored events in the database in batches of size EventDecoder.BatchSize` and calls the `consumeBlock` for each batch.
-    // After the `consumeBlock` has been called the stored events are deleted from the database.
-    // This method terminates when no more events are in the database.
+    // Processes the events in the log in batches of size `HugeEventDecoder.BatchSize` and calls the `consumeBlock` for each batch.
+    // After the `consumeBlock` has been called the batch is committed.
+    // This method terminates when no more events are in the log.
     private func process(_ consumeBlock: ConsumeBlock, firstCall: Bool, isNewNotificationVersion: Bool = false) {
-        let events = fetchNextEventsBatch()
-        guard events.storedEvents.count > 0 else {
+        let batch = eventLog.nextBatch(maxCount: HugeEventDecoder.BatchSize)
+        guard !batch.events.isEmpty else {
             if firstCall {
                 consumeBlock([])
             }
+            // Drop entries that could not be read
+            eventLog.commit(batch)
             return
         }
-
-        processBatch(events.updateEvents, storedEvents: events.storedEvents, block: consumeBlock, isNewNotificationVersion: isNewNotificationVersion)
+        
+        Logging.eventProcessing.info("Forwarding \(batch.events.count) huge event(s) to consumers")
+        consumeBlock(filterInvalidEvents(from: batch.events))
+        
+        if !isNewNotificationVersion {
+            eventLog.commit(batch)
+        }
         process(consumeBlock, firstCall: false)
     }
     
-    /// Calls the `ComsumeBlock` and deletes the respective stored events subsequently.
-    private func processBatch(_ events: [ZMUpdateEvent], storedEvents: [NSManagedObject], block: ConsumeBlock, isNewNotificationVersion: Bool = false) {
-        if !events.isEmpty {
-            Logging.eventProcessing.info("Forwarding \(events.count) event(s) to consumers")
-        }
-        
-        block(filterInvalidEvents(from: events))
+    /// Events stored by previous versions as `StoredHugeUpdateEvent` are processed once before the log,
+    /// a flag in the store metadata records that there is nothing left to process.
+    private func processLegacyStoredEventsIfNeeded(_ consumeBlock: ConsumeBlock) {
+        guard !hasProcessedLegacyStoredEvents else { return }
         
-        if !isNewNotificationVersion {
+        while true {
+            var (storedEvents, updateEvents)  = ([StoredHugeUpdateEvent](), [ZMUpdateEvent]())
+            eventMOC.performGroupedBlockAndWait {
+                storedEvents = StoredHugeUpdateEvent.nextEvents(self.eventMOC, batchSize: HugeEventDecoder.BatchSize)
+                updateEvents = StoredHugeUpdateEvent.eventsFromStoredEvents(storedEvents)
+            }
+            guard !storedEvents.isEmpty else { break }
+            
+            consumeBlock(filterInvalidEvents(from: updateEvents))
+            
             eventMOC.performGroupedBlockAndWait {
                 storedEvents.forEach(self.eventMOC.delete(_:))
                 self.eventMOC.saveOrRollback()
             }
         }
-    }
-    
-    /// Fetches and returns the next batch of size `EventDecoder.BatchSize`
-    /// of `StoredEvents` and `ZMUpdateEvent`'s in a `EventsWithStoredEvents` tuple.
-    private func fetchNextEventsBatch() -> EventsWithStoredEvents {
-        var (storedEvents, updateEvents)  = ([StoredHugeUpdateEvent](), [ZMUpdateEvent]())
-
+        
         eventMOC.performGroupedBlockAndWait {
-            storedEvents = StoredHugeUpdateEvent.nextEvents(self.eventMOC, batchSize: HugeEventDecoder.BatchSize)
-            updateEvents = StoredHugeUpdateEvent.eventsFromStoredEvents(storedEvents)
+            self.eventMOC.setPersistentStoreMetadata(hugeEventStorageLog, key: hugeEventStorageKey)
+            self.eventMOC.saveOrRollback()
         }
-        return (storedEvents: storedEvents, updateEvents: updateEvents)
+        hasProcessedLegacyStoredEvents = true
     }
     
+    /// Event IDs persisted by previous versions in the store metadata are handed to the event log once
+    private func moveReceivedEventIDsToEventLog() {
+        guard let ids = eventMOC.persistentStoreMetadata(forKey: previouslyReceivedHugeEventIDsKey) as? [String], !ids.isEmpty else { return }
+        eventLog.rememberEventIDs(ids.compactMap(UUID.init(uuidString:)))
+        eventMOC.setPersistentStoreMetadata(array: [String](), key: previouslyReceivedHugeEventIDsKey)
+    }
 }
 
-// MARK: - List of already received event IDs
+// MARK: - Filtering
 extension HugeEventDecoder {
     
-    /// create event ID store if needed
-    fileprivate func createReceivedHugePushEventIDsStoreIfNecessary() {
-        if self.eventMOC.persistentStoreMetadata(forKey: previouslyReceivedHugeEventIDsKey) as? [String] == nil {
-            self.eventMOC.setPersistentStoreMetadata(array: [String](), key: previouslyReceivedHugeEventIDsKey)
-        }
-    }
-    
-    
-    /// List of already received event IDs
-    fileprivate var alreadyReceivedHugePushEventIDs : Set<UUID> {
-        let array = self.eventMOC.persistentStoreMetadata(forKey: previouslyReceivedHugeEventIDsKey) as! [String]
-        return Set(array.compactMap { UUID(uuidString: $0) })
-    }
-    
-    /// List of already received event IDs as strings
-    fileprivate var alreadyReceivedPushEventIDsStrings : Set<String> {
-        return Set(self.eventMOC.persistentStoreMetadata(forKey: previouslyReceivedHugeEventIDsKey) as! [String])
-    }
-    
-    /// Store received event IDs
-
-    fileprivate func storeReceivedPushEventIDs(from: [ZMUpdateEvent]) {
-        let uuidToAdd = from
-            .filter { $0.source != .webSocket}
-            .compactMap { $0.uuid }
-            .map { $0.transportString() }
-        let allUuidStrings = self.alreadyReceivedPushEventIDsStrings.union(uuidToAdd)
-        
-        self.eventMOC.setPersistentStoreMetadata(array: Array(allUuidStrings), key: previouslyReceivedHugeEventIDsKey)
-    }
-    
-    /// Filters out events that have been received before
-
-    fileprivate func filterAlreadyReceivedEvents(from: [ZMUpdateEvent]) -> [ZMUpdateEvent] {
-        let eventIDsToDiscard = self.alreadyReceivedHugePushEventIDs
-        return from.compactMap { event -> ZMUpdateEvent? in
-            if /*event.source != .pushNotification, */let uuid = event.uuid {
-                return eventIDsToDiscard.contains(uuid) ? nil : event
-            } else {
-                return event
-            }
-        }
-    }
-    
     /// Filters out events that shouldn't be processed
     fileprivate func filterInvalidEvents(from events: [ZMUpdateEvent]) -> [ZMUpdateEvent] {
         let selfConversation = ZMConversation.selfConversation(in: syncMOC)
@@ -198,10 +165,8 @@ extension HugeEventDecoder {
         
     }
 
-    /// Discards the list of already received events
+    /// Discards the list of recently received events
     public func discardListOfAlreadyReceivedHugePushEventIDs() {
-        self.eventMOC.performGroupedBlockAndWait {
-            self.eventMOC.setPersistentStoreMetadata(array: [String](), key: previouslyReceivedHugeEventIDsKey)
-        }
+        eventLog.removeRecentEventIDs()
     }
 }
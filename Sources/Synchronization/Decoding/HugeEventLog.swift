@@ -0,0 +1,391 @@
+import Foundation
+import WireDataModel
+
+private let zmLog = ZMSLog(tag: "HugeEventLog")
+
+/// Append-only log of huge group update events, shared between the app and its extensions.
+///
+/// Events are written as one JSON object per line and a committed read offset is kept next to them.
+/// Consumers read the events in batches and commit a batch once it has been processed, which advances
+/// the offset. If the app crashes before a batch is committed, the batch is read again on the next launch.
+///
+/// Every operation holds an exclusive `flock` on a lock file in the log directory, so the processes
+/// sharing the directory never see each other's partial writes. Consumed bytes are dropped by copying
+/// the unconsumed tail into the file of the next generation, events appended by another process
+/// between `nextBatch(maxCount:)` and `commit(_:)` are therefore never lost.
+///
+/// The log also keeps the IDs of the most recently appended events on disk, so that an event
+/// delivered twice is dropped across relaunches and across processes.
+public final class HugeEventLog {
+
+    /// A batch of events read from the log, to be passed back to `commit(_:)` once processed
+    public struct Batch {
+        public let events: [ZMUpdateEvent]
+        fileprivate let position: Position
+    }
+
+    /// Position of the first unconsumed event: the generation of the log file and the offset in it
+    fileprivate struct Position: Equatable {
+        let generation: UInt64
+        let offset: UInt64
+    }
+
+    private enum Key {
+        static let uuid = "id"
+        static let payload = "payload"
+        static let transient = "transient"
+        static let source = "source"
+        static let debugInformation = "debug"
+    }
+
+    private static let newline = UInt8(ascii: "\n")
+    private static let readChunkSize = 256 * 1024
+    private static let logFilePrefix = "HugeEvents."
+    private static let logFileExtension = "log"
+
+    /// Consumed bytes are dropped once there are more than this many of them at the start of the file
+    static let compactionThreshold: UInt64 = 1024 * 1024
+
+    /// Number of recently appended event IDs remembered to drop events delivered twice
+    static let recentEventIDsCapacity = 1000
+
+    let directory: URL
+    let stateURL: URL
+    let recentEventIDsURL: URL
+    private let lockURL: URL
+    private let isolationQueue = DispatchQueue(label: "HugeEventLog")
+
+    public init(directory: URL) {
+        FileManager.default.createAndProtectDirectory(at: directory)
+        self.directory = directory
+        self.stateURL = directory.appendingPathComponent("HugeEvents.state")
+        self.recentEventIDsURL = directory.appendingPathComponent("HugeEvents.ids")
+        self.lockURL = directory.appendingPathComponent("HugeEvents.lock")
+
+        withExclusiveAccess {
+            removeStaleLogFiles(keeping: readPosition().generation)
+        }
+    }
+
+    /// URL of the file holding the unconsumed events
+    var logURL: URL {
+        return withExclusiveAccess {
+            logURL(for: readPosition().generation)
+        }
+    }
+
+    /// Appends the events at the end of the log, skipping the ones that were appended recently.
+    /// - returns: the events that were appended
+    @discardableResult
+    public func append(_ events: [ZMUpdateEvent]) -> [ZMUpdateEvent] {
+        guard !events.isEmpty else { return [] }
+
+        return withExclusiveAccess {
+            var recentEventIDs = readRecentEventIDs()
+            let newEvents = events.filter { event in
+                guard let uuid = event.uuid else { return true }
+                return recentEventIDs.insert(uuid)
+            }
+
+            var data = Data()
+            for event in newEvents {
+                guard let line = HugeEventLog.serialize(event) else {
+                    zmLog.error("Dropping huge event that can't be serialized: \(String(describing: event.uuid))")
+                    continue
+                }
+                data.append(line)
+                data.append(HugeEventLog.newline)
+            }
+
+            if !data.isEmpty {
+                let url = logURL(for: readPosition().generation)
+                if !FileManager.default.fileExists(atPath: url.path) {
+                    FileManager.default.createFile(atPath: url.path, contents: nil, attributes: nil)
+                }
+                guard let handle = try? FileHandle(forWritingTo: url) else {
+                    zmLog.error("Can't open huge event log for writing")
+                    return []
+                }
+                handle.seekToEndOfFile()
+                handle.write(data)
+                handle.closeFile()
+            }
+
+            write(recentEventIDs)
+            return newEvents
+        }
+    }
+
+    /// Reads up to `maxCount` events following the last committed batch
+    public func nextBatch(maxCount: Int) -> Batch {
+        return withExclusiveAccess {
+            let position = readPosition()
+            guard maxCount > 0, let handle = try? FileHandle(forReadingFrom: logURL(for: position.generation)) else {
+                return Batch(events: [], position: position)
+            }
+            defer { handle.closeFile() }
+
+            handle.seek(toFileOffset: position.offset)
+
+            var events: [ZMUpdateEvent] = []
+            var endOffset = position.offset
+            var pending = Data()
+
+            reading: while events.count < maxCount {
+                let chunk = handle.readData(ofLength: HugeEventLog.readChunkSize)
+                guard !chunk.isEmpty else { break }
+                pending.append(chunk)
+
+                var lineStart = pending.startIndex
+                while let lineEnd = pending[lineStart...].firstIndex(of: HugeEventLog.newline) {
+                    if let event = HugeEventLog.deserialize(pending[lineStart..<lineEnd]) {
+                        events.append(event)
+                    }
+                    endOffset += UInt64(lineEnd - lineStart + 1)
+                    lineStart = lineEnd + 1
+                    if events.count == maxCount {
+                        break reading
+                    }
+                }
+                pending = pending[lineStart...]
+            }
+
+            return Batch(events: events, position: Position(generation: position.generation, offset: endOffset))
+        }
+    }
+
+    /// Marks the events of the batch as consumed.
+    /// Batches read before the log was compacted or emptied by another process are ignored.
+    public func commit(_ batch: Batch) {
+        withExclusiveAccess {
+            let position = readPosition()
+            guard batch.position.generation == position.generation, batch.position.offset > position.offset else { return }
+
+            let fileSize = self.fileSize(of: logURL(for: position.generation))
+            if batch.position.offset >= fileSize || batch.position.offset >= HugeEventLog.compactionThreshold {
+                compact(from: batch.position)
+            } else {
+                write(batch.position)
+            }
+        }
+    }
+
+    /// Whether there are events that have not been committed yet
+    public var isEmpty: Bool {
+        return withExclusiveAccess {
+            let position = readPosition()
+            return fileSize(of: logURL(for: position.generation)) <= position.offset
+        }
+    }
+
+    /// Discards all the events in the log
+    public func removeAll() {
+        withExclusiveAccess {
+            let position = readPosition()
+            write(Position(generation: position.generation + 1, offset: 0))
+            try? FileManager.default.removeItem(at: logURL(for: position.generation))
+        }
+    }
+
+    /// Forgets the IDs of the recently appended events
+    public func removeRecentEventIDs() {
+        withExclusiveAccess {
+            try? FileManager.default.removeItem(at: recentEventIDsURL)
+        }
+    }
+
+    /// Remembers event IDs received before the log existed, so that their events are not appended again
+    public func rememberEventIDs(_ ids: [UUID]) {
+        guard !ids.isEmpty else { return }
+        withExclusiveAccess {
+            var recentEventIDs = readRecentEventIDs()
+            ids.forEach { recentEventIDs.insert($0) }
+            write(recentEventIDs)
+        }
+    }
+
+    // MARK: - Helpers
+
+    /// Runs the block holding the isolation queue and the lock file shared with the other processes
+    private func withExclusiveAccess<T>(_ block: () -> T) -> T {
+        return isolationQueue.sync {
+            let descriptor = open(lockURL.path, O_RDWR | O_CREAT, 0o644)
+            guard descriptor >= 0 else {
+                zmLog.error("Can't open huge event log lock file, errno: \(errno)")
+                return block()
+            }
+            defer { close(descriptor) }
+
+            while flock(descriptor, LOCK_EX) != 0 && errno == EINTR { }
+            defer { flock(descriptor, LOCK_UN) }
+
+            return block()
+        }
+    }
+
+    /// Moves the events following `position` to the file of the next generation and drops the old file.
+    /// The new file is written before the state points to it, a crash in between leaves a stale file that
+    /// is removed on the next launch.
+    private func compact(from position: Position) {
+        let oldURL = logURL(for: position.generation)
+        let next = Position(generation: position.generation + 1, offset: 0)
+
+        if position.offset < fileSize(of: oldURL) {
+            guard let handle = try? FileHandle(forReadingFrom: oldURL) else { return }
+            handle.seek(toFileOffset: position.offset)
+            let tail = handle.readDataToEndOfFile()
+            handle.closeFile()
+
+            do {
+                try tail.write(to: logURL(for: next.generation), options: .atomic)
+            } catch {
+                zmLog.error("Can't compact huge event log, keeping the consumed events: \(error)")
+                write(position)
+                return
+            }
+        }
+
+        write(next)
+        try? FileManager.default.removeItem(at: oldURL)
+    }
+
+    private func removeStaleLogFiles(keeping generation: UInt64) {
+        let currentName = logURL(for: generation).lastPathComponent
+        let names = (try? FileManager.default.contentsOfDirectory(atPath: directory.path)) ?? []
+        names
+            .filter { $0.hasPrefix(HugeEventLog.logFilePrefix) && $0.hasSuffix(HugeEventLog.logFileExtension) && $0 != currentName }
+            .forEach { try? FileManager.default.removeItem(at: directory.appendingPathComponent($0)) }
+    }
+
+    private func logURL(for generation: UInt64) -> URL {
+        return directory.appendingPathComponent("\(HugeEventLog.logFilePrefix)\(generation).\(HugeEventLog.logFileExtension)")
+    }
+
+    private func fileSize(of url: URL) -> UInt64 {
+        let attributes = try? FileManager.default.attributesOfItem(atPath: url.path)
+        return (attributes?[.size] as? NSNumber)?.uint64Value ?? 0
+    }
+
+    private func readPosition() -> Position {
+        guard
+            let data = try? Data(contentsOf: stateURL),
+            let components = String(data: data, encoding: .utf8)?.split(separator: " "),
+            components.count == 2,
+            let generation = UInt64(components[0]),
+            let offset = UInt64(components[1]) else { return Position(generation: 0, offset: 0) }
+        return Position(generation: generation, offset: offset)
+    }
+
+    private func write(_ position: Position) {
+        do {
+            try "\(position.generation) \(position.offset)".data(using: .utf8)?.write(to: stateURL, options: .atomic)
+        } catch {
+            zmLog.error("Can't write huge event log state: \(error)")
+        }
+    }
+
+    private func readRecentEventIDs() -> RecentEventIDs {
+        let data = (try? Data(contentsOf: recentEventIDsURL)) ?? Data()
+        return RecentEventIDs(capacity: HugeEventLog.recentEventIDsCapacity, data: data)
+    }
+
+    private func write(_ recentEventIDs: RecentEventIDs) {
+        try? recentEventIDs.data.write(to: recentEventIDsURL, options: .atomic)
+    }
+
+    private static func serialize(_ event: ZMUpdateEvent) -> Data? {
+        var object: [String: Any] = [
+            Key.payload: event.payload,
+            Key.transient: event.isTransient,
+            Key.source: event.source.rawValue
+        ]
+        object[Key.uuid] = event.uuid?.transportString()
+        object[Key.debugInformation] = event.debugInformation
+
+        guard JSONSerialization.isValidJSONObject(object) else { return nil }
+        return try? JSONSerialization.data(withJSONObject: object, options: [])
+    }
+
+    private static func deserialize(_ line: Data) -> ZMUpdateEvent? {
+        guard
+            let object = (try? JSONSerialization.jsonObject(with: line, options: [])) as? [String: Any],
+            let payload = object[Key.payload] as? NSDictionary,
+            let rawSource = object[Key.source] as? Int,
+            let source = ZMUpdateEventSource(rawValue: rawSource) else {
+                zmLog.error("Skipping corrupted huge event log entry")
+                return nil
+        }
+
+        let uuid = (object[Key.uuid] as? String).flatMap(UUID.init(uuidString:))
+        let transient = object[Key.transient] as? Bool ?? false
+        let event = ZMUpdateEvent.decryptedUpdateEvent(fromEventStreamPayload: payload, uuid: uuid, transient: transient, source: source)
+        if let debugInformation = object[Key.debugInformation] as? String {
+            event?.appendDebugInformation(debugInformation)
+        }
+        return event
+    }
+}
+
+// MARK: - Recent event IDs
+
+/// Bounded set of the most recently inserted event IDs
+struct RecentEventIDs {
+
+    let capacity: Int
+    private var ids = Set<UUID>()
+    private var order: [UUID] = []
+    private var oldestIndex = 0
+
+    init(capacity: Int) {
+        self.capacity = capacity
+    }
+
+    /// Restores the IDs serialized with `data`
+    init(capacity: Int, data: Data) {
+        self.init(capacity: capacity)
+        let size = MemoryLayout<uuid_t>.size
+        var start = data.startIndex
+        while start + size <= data.endIndex {
+            let id = data[start..<start + size].withUnsafeBytes { UUID(uuid: $0.load(as: uuid_t.self)) }
+            insert(id)
+            start += size
+        }
+    }
+
+    /// The IDs from the oldest to the most recent one, 16 bytes each
+    var data: Data {
+        var data = Data(capacity: order.count * MemoryLayout<uuid_t>.size)
+        for index in 0..<order.count {
+            var uuid = order[(oldestIndex + index) % order.count].uuid
+            withUnsafeBytes(of: &uuid) { data.append(contentsOf: $0) }
+        }
+        return data
+    }
+
+    /// Inserts the ID, evicting the oldest one when full.
+    /// - returns: false if the ID was already present
+    @discardableResult
+    mutating func insert(_ id: UUID) -> Bool {
+        guard !ids.contains(id) else { return false }
+
+        if order.count < capacity {
+            order.append(id)
+        } else {
+            ids.remove(order[oldestIndex])
+            order[oldestIndex] = id
+            oldestIndex = (oldestIndex + 1) % capacity
+        }
+        ids.insert(id)
+        return true
+    }
+
+    func contains(_ id: UUID) -> Bool {
+        return ids.contains(id)
+    }
+
+    mutating func removeAll() {
+        ids.removeAll()
+        order.removeAll()
+        oldestIndex = 0
+    }
+}
@@ -0,0 +1,200 @@
+
+import XCTest
+@testable import WireRequestStrategy
+
+class HugeEventLogTests: XCTestCase {
+
+    var directory: URL!
+    var sut: HugeEventLog!
+
+    override func setUp() {
+        super.setUp()
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        sut = HugeEventLog(directory: directory)
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(at: directory)
+        directory = nil
+        sut = nil
+        super.tearDown()
+    }
+
+    func event(text: String) -> ZMUpdateEvent {
+        let payload = [
+            "type": "conversation.bgp-message-add",
+            "conversation": UUID.create().transportString(),
+            "from": UUID.create().transportString(),
+            "time": Date().transportString(),
+            "data": ["text": text]
+            ] as NSDictionary
+        return ZMUpdateEvent.decryptedUpdateEvent(fromEventStreamPayload: payload, uuid: UUID.create(), transient: false, source: .webSocket)!
+    }
+
+    func testThatItReturnsAppendedEventsInOrder() {
+        // GIVEN
+        let events = (0..<5).map { event(text: "\($0)") }
+
+        // WHEN
+        sut.append(events)
+        let batch = sut.nextBatch(maxCount: 10)
+
+        // THEN
+        XCTAssertEqual(batch.events.map { $0.uuid }, events.map { $0.uuid })
+        XCTAssertEqual(batch.events.map { $0.source }, events.map { $0.source })
+        XCTAssertEqual(batch.events.first?.payload as NSDictionary?, events.first?.payload as NSDictionary?)
+    }
+
+    func testThatItReturnsTheNextBatchOnlyAfterCommitting() {
+        // GIVEN
+        let events = (0..<5).map { event(text: "\($0)") }
+        sut.append(events)
+
+        // WHEN
+        let firstBatch = sut.nextBatch(maxCount: 3)
+        let repeatedBatch = sut.nextBatch(maxCount: 3)
+        sut.commit(firstBatch)
+        let secondBatch = sut.nextBatch(maxCount: 3)
+
+        // THEN
+        XCTAssertEqual(firstBatch.events.map { $0.uuid }, events[0..<3].map { $0.uuid })
+        XCTAssertEqual(repeatedBatch.events.map { $0.uuid }, events[0..<3].map { $0.uuid })
+        XCTAssertEqual(secondBatch.events.map { $0.uuid }, events[3..<5].map { $0.uuid })
+    }
+
+    func testThatItIsEmptyAfterCommittingAllEvents() {
+        // GIVEN
+        sut.append([event(text: "1"), event(text: "2")])
+        XCTAssertFalse(sut.isEmpty)
+
+        // WHEN
+        sut.commit(sut.nextBatch(maxCount: 10))
+
+        // THEN
+        XCTAssertTrue(sut.isEmpty)
+        XCTAssertFalse(FileManager.default.fileExists(atPath: sut.logURL.path))
+        XCTAssertTrue(sut.nextBatch(maxCount: 10).events.isEmpty)
+    }
+
+    func testThatItKeepsEventsAppendedByAnotherInstanceBetweenReadingAndCommitting() {
+        // GIVEN
+        let events = (0..<3).map { event(text: "\($0)") }
+        sut.append(Array(events[0..<2]))
+        let batch = sut.nextBatch(maxCount: 10)
+
+        // WHEN
+        HugeEventLog(directory: directory).append([events[2]])
+        sut.commit(batch)
+
+        // THEN
+        XCTAssertFalse(sut.isEmpty)
+        XCTAssertEqual(sut.nextBatch(maxCount: 10).events.map { $0.uuid }, [events[2].uuid])
+    }
+
+    func testThatItIgnoresABatchCommittedByAnotherInstance() {
+        // GIVEN
+        let events = (0..<3).map { event(text: "\($0)") }
+        sut.append(Array(events[0..<2]))
+        let otherLog = HugeEventLog(directory: directory)
+        let batch = sut.nextBatch(maxCount: 10)
+        otherLog.commit(otherLog.nextBatch(maxCount: 10))
+        otherLog.append([events[2]])
+
+        // WHEN
+        sut.commit(batch)
+
+        // THEN
+        XCTAssertEqual(sut.nextBatch(maxCount: 10).events.map { $0.uuid }, [events[2].uuid])
+    }
+
+    func testThatItDropsEventsThatWereAlreadyAppended() {
+        // GIVEN
+        let events = (0..<2).map { event(text: "\($0)") }
+        sut.append(events)
+        sut.commit(sut.nextBatch(maxCount: 10))
+
+        // WHEN
+        let appended = HugeEventLog(directory: directory).append(events + [event(text: "2")])
+
+        // THEN
+        XCTAssertEqual(appended.count, 1)
+        XCTAssertEqual(sut.nextBatch(maxCount: 10).events.count, 1)
+    }
+
+    func testThatItAppendsEventsAgainAfterRemovingTheRecentEventIDs() {
+        // GIVEN
+        let events = (0..<2).map { event(text: "\($0)") }
+        sut.append(events)
+
+        // WHEN
+        sut.removeRecentEventIDs()
+        let appended = sut.append(events)
+
+        // THEN
+        XCTAssertEqual(appended.count, 2)
+    }
+
+    func testThatItKeepsTheReadOffsetAcrossInstances() {
+        // GIVEN
+        let events = (0..<4).map { event(text: "\($0)") }
+        sut.append(events)
+        sut.commit(sut.nextBatch(maxCount: 2))
+
+        // WHEN
+        let newLog = HugeEventLog(directory: directory)
+        let batch = newLog.nextBatch(maxCount: 10)
+
+        // THEN
+        XCTAssertEqual(batch.events.map { $0.uuid }, events[2..<4].map { $0.uuid })
+    }
+
+    func testThatRemoveAllDiscardsEvents() {
+        // GIVEN
+        sut.append([event(text: "1")])
+
+        // WHEN
+        sut.removeAll()
+
+        // THEN
+        XCTAssertTrue(sut.isEmpty)
+    }
+}
+
+// MARK: - Recent event IDs
+extension HugeEventLogTests {
+
+    func testThatRecentEventIDsRejectsDuplicates() {
+        var ids = RecentEventIDs(capacity: 2)
+        let id = UUID.create()
+
+        XCTAssertTrue(ids.insert(id))
+        XCTAssertFalse(ids.insert(id))
+    }
+
+    func testThatRecentEventIDsEvictsTheOldestID() {
+        var ids = RecentEventIDs(capacity: 2)
+        let (first, second, third) = (UUID.create(), UUID.create(), UUID.create())
+
+        ids.insert(first)
+        ids.insert(second)
+        ids.insert(third)
+
+        XCTAssertFalse(ids.contains(first))
+        XCTAssertTrue(ids.contains(second))
+        XCTAssertTrue(ids.contains(third))
+    }
+
+    func testThatRecentEventIDsAreRestoredFromTheirData() {
+        var ids = RecentEventIDs(capacity: 2)
+        let (first, second, third) = (UUID.create(), UUID.create(), UUID.create())
+        ids.insert(first)
+        ids.insert(second)
+        ids.insert(third)
+
+        var restored = RecentEventIDs(capacity: 2, data: ids.data)
+        restored.insert(UUID.create())
+
+        XCTAssertFalse(restored.contains(second))
+        XCTAssertTrue(restored.contains(third))
+    }
+}
@@ -36,3 +36,4 @@ FOUNDATION_EXPORT const unsigned char WireRequestStrategyVersionString[];
 #import <WireRequestStrategy/ZMAbstractRequestStrategy.h>
 #import <WireRequestStrategy/RequestStrategy.h>
 #import <WireRequestStrategy/ZMSimpleListRequestPaginator.h>
+#import <WireRequestStrategy/ZMAtomicCounter.h>
@@ -21,19 +21,31 @@ public class MockApplicationStatus : NSObject, ApplicationStatus {
         return self.mockClientRegistrationStatus
     }
 
-    public var notificationFetchStatus = BackgroundNotificationFetchStatus.done
+    public var notificationFetchStatus = BackgroundNotificationFetchStatus.done {
+        didSet { requestGatingState.update(from: self) }
+    }
+
+    public private(set) lazy var requestGatingState = RequestGatingState(applicationStatus: self)
+
+    deinit {
+        requestGatingState.invalidate()
+    }
 
     public let mockConfirmationStatus = MockConfirmationStatus()
     public let mockTaskCancellationDelegate = MockTaskCancellationDelegate()
     public var mockClientRegistrationStatus = MockClientRegistrationStatus()
     
-    public var mockSynchronizationState : SynchronizationState = .unauthenticated
+    public var mockSynchronizationState : SynchronizationState = .unauthenticated {
+        didSet { requestGatingState.update(from: self) }
+    }
     
     public var synchronizationState: SynchronizationState {
         return mockSynchronizationState
     }
 
-    public var mockOperationState : OperationState = .foreground
+    public var mockOperationState : OperationState = .foreground {
+        didSet { requestGatingState.update(from: self) }
+    }
     
     public var operationState: OperationState {
         return mockOperationState
@@ -127,3 +139,27 @@ class MockPushMessageHandler: NSObject, PushMessageHandler {
     fileprivate(set) var processedMessages: [ZMMessage] = []
     fileprivate(set) var processedGenericMessages: [ZMGenericMessage] = []
 }
+
+@objc public class MockAnalytics: NSObject, AnalyticsType {
+
+    public var taggedEvents: [(event: String, attributes: [String: NSObject])] = []
+    public var persistedAttributesByEvent: [String: [String: NSObject]] = [:]
+    public var persistedAttributesWriteCount = 0
+
+    public func tagEvent(_ event: String) {
+        taggedEvents.append((event, [:]))
+    }
+
+    public func tagEvent(_ event: String, attributes: [String: NSObject]) {
+        taggedEvents.append((event, attributes))
+    }
+
+    public func setPersistedAttributes(_ attributes: [String: NSObject]?, for event: String) {
+        persistedAttributesWriteCount += 1
+        persistedAttributesByEvent[event] = attributes
+    }
+
+    public func persistedAttributes(for event: String) -> [String: NSObject]? {
+        return persistedAttributesByEvent[event]
+    }
+}
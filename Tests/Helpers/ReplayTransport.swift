@@ -0,0 +1,122 @@
+//
+
+import Foundation
+import WireRequestStrategy
+
+/// Stands in for the transport session when replaying a `SessionTrace`, answering each request
+/// with the next response recorded for the same method and path.
+///
+/// Time is simulated: a request completes once `completeNextRequest()` advanced the clock to its
+/// arrival time, so replays are deterministic and don't wait for the latency.
+final class ReplayTransport {
+
+    enum Latency {
+        /// The latency recorded with the response
+        case recorded
+        case fixed(TimeInterval)
+    }
+
+    private struct PendingResponse {
+        let arrivalTime: TimeInterval
+        let sequenceNumber: Int
+        let request: ZMTransportRequest
+        let response: ZMTransportResponse
+    }
+
+    var latency: Latency
+    /// Status of the response to requests for which no response was recorded
+    var unmatchedResponseStatus = 404
+
+    /// Time elapsed on the simulated clock
+    private(set) var currentTime: TimeInterval = 0
+    private(set) var sentRequests: [ZMTransportRequest] = []
+    private(set) var unmatchedRequests: [ZMTransportRequest] = []
+
+    private var responsesByPath: [String: [SessionTrace.RecordedResponse]] = [:]
+    private var responsesByPathTemplate: [String: [SessionTrace.RecordedResponse]] = [:]
+    private var pendingResponses: [PendingResponse] = []
+    private var nextSequenceNumber = 0
+
+    init(responses: [SessionTrace.RecordedResponse], latency: Latency = .recorded) {
+        self.latency = latency
+        for response in responses {
+            responsesByPath[ReplayTransport.key(response.method, response.path), default: []].append(response)
+            responsesByPathTemplate[ReplayTransport.key(response.method, ReplayTransport.template(for: response.path)), default: []].append(response)
+        }
+    }
+
+    var hasRequestsInFlight: Bool {
+        return !pendingResponses.isEmpty
+    }
+
+    func send(_ request: ZMTransportRequest) {
+        sentRequests.append(request)
+
+        let recordedResponse = nextRecordedResponse(for: request)
+        if recordedResponse == nil {
+            unmatchedRequests.append(request)
+        }
+
+        let response = ZMTransportResponse(payload: recordedResponse?.payload,
+                                           httpStatus: recordedResponse?.httpStatus ?? unmatchedResponseStatus,
+                                           transportSessionError: nil)
+        let requestLatency: TimeInterval
+        switch latency {
+        case .recorded: requestLatency = recordedResponse?.latency ?? 0
+        case .fixed(let fixedLatency): requestLatency = fixedLatency
+        }
+
+        pendingResponses.append(PendingResponse(arrivalTime: currentTime + requestLatency, sequenceNumber: nextSequenceNumber, request: request, response: response))
+        nextSequenceNumber += 1
+    }
+
+    /// Advances the clock to the arrival of the next response and completes its request.
+    /// Returns `false` if there is no request in flight.
+    @discardableResult
+    func completeNextRequest() -> Bool {
+        guard let next = pendingResponses.enumerated().min(by: { ($0.element.arrivalTime, $0.element.sequenceNumber) < ($1.element.arrivalTime, $1.element.sequenceNumber) }) else {
+            return false
+        }
+        pendingResponses.remove(at: next.offset)
+        currentTime = max(currentTime, next.element.arrivalTime)
+        next.element.request.complete(with: next.element.response)
+        return true
+    }
+
+    /// The path with its identifiers replaced, e.g. `/conversations/{id}/otr/messages`
+    static func template(for path: String) -> String {
+        return identifierExpression.stringByReplacingMatches(in: path, range: NSRange(path.startIndex..., in: path), withTemplate: "{id}")
+    }
+
+    // MARK: - Helpers
+
+    private static let identifierExpression = try! NSRegularExpression(pattern: "[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}|[0-9a-fA-F]{16}", options: [])
+
+    private static func key(_ method: ZMTransportRequestMethod, _ path: String) -> String {
+        return "\(method.rawValue) \(path)"
+    }
+
+    /// Takes the response recorded for the path, or for a path of the same shape when the identifiers
+    /// differ, e.g. because they were generated locally during the recording
+    private func nextRecordedResponse(for request: ZMTransportRequest) -> SessionTrace.RecordedResponse? {
+        let exactKey = ReplayTransport.key(request.method, request.path)
+        let templateKey = ReplayTransport.key(request.method, ReplayTransport.template(for: request.path))
+
+        if let response = responsesByPath[exactKey]?.first {
+            responsesByPath[exactKey]?.removeFirst()
+            if let index = responsesByPathTemplate[templateKey]?.firstIndex(where: { $0.path == response.path }) {
+                responsesByPathTemplate[templateKey]?.remove(at: index)
+            }
+            return response
+        }
+        if let response = responsesByPathTemplate[templateKey]?.first {
+            responsesByPathTemplate[templateKey]?.removeFirst()
+            let originalKey = ReplayTransport.key(response.method, response.path)
+            if responsesByPath[originalKey]?.isEmpty == false {
+                responsesByPath[originalKey]?.removeFirst()
+            }
+            return response
+        }
+        return nil
+    }
+}
@@ -0,0 +1,166 @@
+//
+
+import Foundation
+import WireRequestStrategy
+import WireDataModel
+
+/// Replays a `SessionTrace` through a set of strategies, driving them the way the sync engine does,
+/// and reports what it cost. Meant to compare changes of the strategies and object syncs against
+/// the same recorded workload.
+///
+/// The strategies are asked for requests until none has one left, the requests are answered by a
+/// `ReplayTransport` and the changes made to the context are passed to their change trackers.
+final class SessionReplayHarness {
+
+    struct Report {
+        var requestsIssued = 0
+        /// Number of requests by method and path template, e.g. `POST /conversations/{id}/otr/messages`
+        var requestsByPath: [String: Int] = [:]
+        /// Requests for which no response was recorded
+        var unmatchedRequests = 0
+        /// Time until all requests were answered, on the simulated clock of the transport
+        var simulatedDrainTime: TimeInterval = 0
+        /// Time spent replaying, excluding the latency of the transport
+        var wallClockDrainTime: TimeInterval = 0
+        /// Time spent by the event consumers processing the update events
+        var eventProcessingTime: TimeInterval = 0
+        /// Time spent by the change trackers processing the changes of the context
+        var changeProcessingTime: TimeInterval = 0
+        /// Growth of the memory footprint of the process, in bytes
+        var peakMemoryGrowth: Int64 = 0
+        /// Set if the replay stopped because the strategies kept creating requests
+        var reachedRequestLimit = false
+    }
+
+    let context: NSManagedObjectContext
+    let transport: ReplayTransport
+    /// Changes made by the user during the recording, by the name they were recorded with
+    var localChanges: [String: (NSManagedObjectContext) -> Void] = [:]
+    /// Maximum number of requests issued by a replay
+    var requestLimit = 10_000
+
+    private let requestStrategies: [RequestStrategy]
+    private let eventConsumers: [ZMEventConsumer]
+    private let changeTrackers: [ZMContextChangeTracker]
+    private let waitForAllGroupsToBeEmpty: () -> Bool
+
+    /// - parameter strategies: request strategies, event consumers and change tracker sources, polled for requests in this order
+    /// - parameter waitForAllGroupsToBeEmpty: waits for the work dispatched by the strategies, e.g. from the test case
+    init(context: NSManagedObjectContext, strategies: [NSObjectProtocol], transport: ReplayTransport, waitForAllGroupsToBeEmpty: @escaping () -> Bool) {
+        self.context = context
+        self.transport = transport
+        self.requestStrategies = strategies.compactMap { $0 as? RequestStrategy }
+        self.eventConsumers = strategies.compactMap { $0 as? ZMEventConsumer }
+        self.changeTrackers = strategies.compactMap { $0 as? ZMContextChangeTrackerSource }.flatMap { $0.contextChangeTrackers }
+        self.waitForAllGroupsToBeEmpty = waitForAllGroupsToBeEmpty
+    }
+
+    func replay(_ trace: SessionTrace) -> Report {
+        var report = Report()
+        let initialMemory = SessionReplayHarness.memoryFootprint()
+        let startTime = CFAbsoluteTimeGetCurrent()
+        let startSimulatedTime = transport.currentTime
+
+        context.performGroupedBlockAndWait {
+            ZMChangeTrackerBootstrap(managedObjectContext: self.context, changeTrackers: self.changeTrackers).fetchObjectsForChangeTrackers()
+        }
+
+        for step in trace.steps where !report.reachedRequestLimit {
+            switch step {
+            case .updateEvents(let recordedEvents):
+                let events = recordedEvents.compactMap { $0.updateEvent }
+                context.performGroupedBlockAndWait {
+                    let eventsStartTime = CFAbsoluteTimeGetCurrent()
+                    self.eventConsumers.forEach { $0.processEvents(events, liveEvents: true, prefetchResult: nil) }
+                    report.eventProcessingTime += CFAbsoluteTimeGetCurrent() - eventsStartTime
+                }
+            case .localChange(let name):
+                guard let change = localChanges[name] else {
+                    preconditionFailure("No local change registered for \(name)")
+                }
+                context.performGroupedBlockAndWait {
+                    change(self.context)
+                }
+            }
+            _ = waitForAllGroupsToBeEmpty()
+            processChanges(&report)
+            drain(&report)
+            report.peakMemoryGrowth = max(report.peakMemoryGrowth, SessionReplayHarness.memoryFootprint() - initialMemory)
+        }
+
+        report.wallClockDrainTime = CFAbsoluteTimeGetCurrent() - startTime
+        report.simulatedDrainTime = transport.currentTime - startSimulatedTime
+        report.unmatchedRequests = transport.unmatchedRequests.count
+        return report
+    }
+
+    // MARK: - Helpers
+
+    /// Sends the requests of the strategies until none has one left and all were answered
+    private func drain(_ report: inout Report) {
+        repeat {
+            while let request = nextRequest() {
+                transport.send(request)
+                report.requestsIssued += 1
+                report.requestsByPath["\(methodName(request.method)) \(ReplayTransport.template(for: request.path))", default: 0] += 1
+                if report.requestsIssued >= requestLimit {
+                    report.reachedRequestLimit = true
+                    return
+                }
+            }
+            guard transport.completeNextRequest() else { return }
+            _ = waitForAllGroupsToBeEmpty()
+            processChanges(&report)
+        } while true
+    }
+
+    private func nextRequest() -> ZMTransportRequest? {
+        var request: ZMTransportRequest?
+        context.performGroupedBlockAndWait {
+            for strategy in self.requestStrategies {
+                request = strategy.nextRequest()
+                if request != nil {
+                    break
+                }
+            }
+        }
+        return request
+    }
+
+    /// Passes the objects changed since the last save to the change trackers and saves
+    private func processChanges(_ report: inout Report) {
+        var processingTime: TimeInterval = 0
+        context.performGroupedBlockAndWait {
+            let changedObjects = self.context.insertedObjects.union(self.context.updatedObjects)
+            if !changedObjects.isEmpty {
+                let changesStartTime = CFAbsoluteTimeGetCurrent()
+                self.changeTrackers.forEach { $0.objectsDidChange(changedObjects) }
+                processingTime = CFAbsoluteTimeGetCurrent() - changesStartTime
+            }
+            self.context.saveOrRollback()
+        }
+        report.changeProcessingTime += processingTime
+    }
+
+    private func methodName(_ method: ZMTransportRequestMethod) -> String {
+        switch method {
+        case .methodGET: return "GET"
+        case .methodPOST: return "POST"
+        case .methodPUT: return "PUT"
+        case .methodDELETE: return "DELETE"
+        case .methodHEAD: return "HEAD"
+        @unknown default: return "\(method.rawValue)"
+        }
+    }
+
+    private static func memoryFootprint() -> Int64 {
+        var info = task_vm_info_data_t()
+        var count = mach_msg_type_number_t(MemoryLayout<task_vm_info_data_t>.size / MemoryLayout<natural_t>.size)
+        let result = withUnsafeMutablePointer(to: &info) {
+            $0.withMemoryRebound(to: integer_t.self, capacity: Int(count)) {
+                task_info(mach_task_self_, task_flavor_t(TASK_VM_INFO), $0, &count)
+            }
+        }
+        return result == KERN_SUCCESS ? Int64(info.phys_footprint) : 0
+    }
+}